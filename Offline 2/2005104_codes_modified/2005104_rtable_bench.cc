@@ -0,0 +1,514 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+/*
+ * Microbenchmarks of the routing table of the modified AODV model (aodv-rtable.cc).
+ *
+ * - lookup: fill the table with N routes of random lifetimes. While the simulation clock advances,
+ *   route packets of 100 active flows, looking their routes up and refreshing them as
+ *   RouteOutput and Forwarding do. Meanwhile the other routes keep expiring and being
+ *   rediscovered, outside of the measurement. Prints the mean cost per packet, expiry processing
+ *   included, for N from 10 to maxRoutes. With expiry driven by the min-heap, it does not grow
+ *   with N.
+ * - invalidate: in a table of 1000 routes, invalidate 100 random destinations at once as a RERR
+ *   does with InvalidateRoutesWithDst(). Prints its mean cost. The routes are revalidated
+ *   outside of the measurement.
+ * - sweep: in a table of N routes which keep expiring and being rediscovered, time the Purge()
+ *   that follows each 20 ms advance of the clock, for N from 10 to maxRoutes.
+ * - expire: give N routes lifetimes within the same second and time every Purge() until they have
+ *   all been invalidated and then deleted, for N from 10 to maxRoutes. Prints the cost per route.
+ * - alloc: count the heap allocations of the routing table calls of a route-hit Forwarding
+ *   (RoutingTable::UseRoute(), on single and two-path routes) and of a missed lookup into a
+ *   default-constructed entry, after a warm-up. Aborts unless there are none.
+ *
+ * The simulation clock is advanced with Simulator::Stop() and Simulator::Run(); no events are
+ * scheduled. Wall-clock costs are measured with std::chrono::steady_clock and printed as CSV.
+ *
+ * Usage: ./ns3 run "2005104_rtable_bench --bench=lookup --flat=0"
+ */
+
+#include "ns3/aodv-rtable.h"
+#include "ns3/core-module.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <random>
+
+using namespace ns3;
+using namespace ns3::aodv;
+
+NS_LOG_COMPONENT_DEFINE("AodvRtableBench");
+
+/// Heap allocations made through operator new, see the alloc benchmark
+static uint64_t g_allocations = 0;
+
+void*
+operator new(std::size_t size)
+{
+    ++g_allocations;
+    if (void* p = std::malloc(size ? size : 1))
+    {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void*
+operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void
+operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void
+operator delete[](void* p) noexcept
+{
+    std::free(p);
+}
+
+void
+operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void
+operator delete[](void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+namespace
+{
+
+/// Clock of the measurements
+using BenchClock = std::chrono::steady_clock;
+
+/// Lifetime given to used routes, as ActiveRouteTimeout
+const Time ACTIVE_ROUTE_TIMEOUT = Seconds(3);
+
+/**
+ * Advance the simulation clock
+ * \param delay the time to advance by
+ */
+void
+AdvanceTime(Time delay)
+{
+    Simulator::Stop(delay);
+    Simulator::Run();
+}
+
+/**
+ * \param i index of a destination
+ * \returns the address of the destination, in 10.0.0.0/8
+ */
+Ipv4Address
+Destination(uint32_t i)
+{
+    return Ipv4Address(0x0a000001 + i);
+}
+
+/**
+ * Build a VALID route
+ * \param dst destination address
+ * \param nextHop next hop address
+ * \param lifetime route lifetime
+ * \returns the routing table entry
+ */
+RoutingTableEntry
+MakeRoute(Ipv4Address dst, Ipv4Address nextHop, Time lifetime)
+{
+    return RoutingTableEntry(/*dev=*/nullptr,
+                             /*dst=*/dst,
+                             /*vSeqNo=*/true,
+                             /*seqNo=*/1,
+                             /*iface=*/Ipv4InterfaceAddress(),
+                             /*hops=*/2,
+                             /*nextHop=*/nextHop,
+                             /*lifetime=*/lifetime);
+}
+
+/// Number of destinations with active flows
+const uint32_t ACTIVE_FLOWS = 100;
+
+/**
+ * Add a VALID route with a random lifetime between 1 and 10 s, or revalidate it
+ * \param table the routing table
+ * \param dst destination address
+ * \param rng random number generator
+ */
+void
+DiscoverRoute(RoutingTable& table, Ipv4Address dst, std::mt19937& rng)
+{
+    Time lifetime = MilliSeconds(std::uniform_int_distribution<uint64_t>(1000, 10000)(rng));
+    if (!table.ModifyRoute(dst, [lifetime](RoutingTableEntry& entry) {
+            entry.SetFlag(VALID);
+            entry.SetLifeTime(lifetime);
+        }))
+    {
+        RoutingTableEntry rt = MakeRoute(dst, Destination(dst.Get() % 16), lifetime);
+        table.AddRoute(rt);
+    }
+}
+
+/**
+ * \param start the start of the measured interval
+ * \returns the nanoseconds elapsed since start
+ */
+double
+ElapsedNs(BenchClock::time_point start)
+{
+    return std::chrono::duration<double, std::nano>(BenchClock::now() - start).count();
+}
+
+/**
+ * Route a packet to dst as RouteOutput and Forwarding do: look the route up and refresh it,
+ * or revalidate or add it as a route discovery would
+ * \param table the routing table
+ * \param dst destination address
+ */
+void
+RoutePacket(RoutingTable& table, Ipv4Address dst)
+{
+    const RoutingTableEntry* rt = table.LookupRoute(dst);
+    if (rt == nullptr)
+    {
+        RoutingTableEntry newEntry = MakeRoute(dst, Destination(0), ACTIVE_ROUTE_TIMEOUT);
+        table.AddRoute(newEntry);
+    }
+    else if (rt->GetFlag() != VALID)
+    {
+        table.ModifyRoute(dst, [](RoutingTableEntry& entry) {
+            entry.SetFlag(VALID);
+            entry.SetLifeTime(ACTIVE_ROUTE_TIMEOUT);
+        });
+    }
+    else
+    {
+        table.TouchRoutes({dst}, ACTIVE_ROUTE_TIMEOUT);
+    }
+}
+
+/**
+ * The lookup benchmark, see the file comment
+ * \param routes number of destinations
+ * \param flat use the hash map storage
+ * \param rng random number generator
+ * \returns the mean cost per packet in ns
+ */
+double
+BenchLookup(uint32_t routes, bool flat, std::mt19937& rng)
+{
+    const uint32_t rounds = 500;
+    const uint32_t packetsPerRound = 200;
+    const Time roundTime = MilliSeconds(20);
+    uint32_t flows = std::min(routes, ACTIVE_FLOWS);
+    std::uniform_int_distribution<uint32_t> pickFlow(0, flows - 1);
+    // Every other route is rediscovered about every 5 s
+    uint32_t discoveriesPerRound = (routes - flows) * (roundTime / Seconds(5)) + 1;
+
+    RoutingTable table(Seconds(15));
+    table.SetFlatStorage(flat);
+    for (uint32_t i = 0; i < routes; ++i)
+    {
+        DiscoverRoute(table, Destination(i), rng);
+    }
+    double ns = 0;
+    uint32_t next = flows;
+    for (uint32_t r = 0; r < rounds; ++r)
+    {
+        AdvanceTime(roundTime);
+        auto start = BenchClock::now();
+        for (uint32_t k = 0; k < packetsPerRound; ++k)
+        {
+            RoutePacket(table, Destination(pickFlow(rng)));
+        }
+        ns += ElapsedNs(start);
+        for (uint32_t k = 0; k < discoveriesPerRound && routes > flows; ++k)
+        {
+            DiscoverRoute(table, Destination(next), rng);
+            next = next + 1 < routes ? next + 1 : flows;
+        }
+    }
+    Simulator::Destroy();
+    return ns / (rounds * packetsPerRound);
+}
+
+/**
+ * The sweep benchmark, see the file comment
+ * \param routes number of routes
+ * \param flat use the hash map storage
+ * \param rng random number generator
+ * \returns the mean cost of Purge() in ns
+ */
+double
+BenchSweep(uint32_t routes, bool flat, std::mt19937& rng)
+{
+    const uint32_t rounds = 500;
+    const Time roundTime = MilliSeconds(20);
+    // Every route is rediscovered about every 5 s
+    uint32_t discoveriesPerRound = routes * (roundTime / Seconds(5)) + 1;
+
+    RoutingTable table(Seconds(15));
+    table.SetFlatStorage(flat);
+    for (uint32_t i = 0; i < routes; ++i)
+    {
+        DiscoverRoute(table, Destination(i), rng);
+    }
+    double ns = 0;
+    uint32_t next = 0;
+    for (uint32_t r = 0; r < rounds; ++r)
+    {
+        AdvanceTime(roundTime);
+        auto start = BenchClock::now();
+        table.Purge();
+        ns += ElapsedNs(start);
+        for (uint32_t k = 0; k < discoveriesPerRound; ++k)
+        {
+            DiscoverRoute(table, Destination(next), rng);
+            next = (next + 1) % routes;
+        }
+    }
+    Simulator::Destroy();
+    return ns / rounds;
+}
+
+/**
+ * The expire benchmark, see the file comment
+ * \param routes number of routes
+ * \param flat use the hash map storage
+ * \param rng random number generator
+ * \returns the Purge() cost per route in ns
+ */
+double
+BenchExpire(uint32_t routes, bool flat, std::mt19937& rng)
+{
+    const uint32_t rounds = 50;
+    const Time roundTime = MilliSeconds(10);
+    const Time badLinkLifetime = Seconds(1);
+
+    double ns = 0;
+    for (uint32_t r = 0; r < rounds; ++r)
+    {
+        RoutingTable table(badLinkLifetime);
+        table.SetFlatStorage(flat);
+        for (uint32_t i = 0; i < routes; ++i)
+        {
+            Time lifetime = MilliSeconds(std::uniform_int_distribution<uint64_t>(1000, 2000)(rng));
+            RoutingTableEntry rt = MakeRoute(Destination(i), Destination(i % 16), lifetime);
+            table.AddRoute(rt);
+        }
+        // Each route is invalidated between 1 and 2 s and deleted a bad link lifetime later
+        for (Time t; t <= Seconds(2) + badLinkLifetime + roundTime; t += roundTime)
+        {
+            AdvanceTime(roundTime);
+            auto start = BenchClock::now();
+            table.Purge();
+            ns += ElapsedNs(start);
+        }
+        Simulator::Destroy();
+    }
+    return ns / (rounds * routes);
+}
+
+/**
+ * Do the routing table calls of a route-hit Forwarding of a packet from origin to dst, through
+ * the RoutingTable::UseRoute() call of RoutingProtocol::Forwarding()
+ * \param table the routing table
+ * \param origin source address of the packet
+ * \param dst destination address of the packet
+ * \param flow flow hash of the packet, which picks the path of a multipath route
+ * \returns the route given to IP
+ */
+Ptr<Ipv4Route>
+ForwardPacket(RoutingTable& table, Ipv4Address origin, Ipv4Address dst, uint32_t flow)
+{
+    Ipv4Address originNextHop;
+    Ptr<Ipv4Route> route = table.UseRoute(
+        origin,
+        dst,
+        ACTIVE_ROUTE_TIMEOUT,
+        [flow](const RoutingTableEntry& toDst) { return flow % toDst.GetPathCount(); },
+        originNextHop);
+    NS_ABORT_MSG_UNLESS(route, "No route to " << dst);
+    return route;
+}
+
+/**
+ * The alloc benchmark, see the file comment
+ * \param routes number of routes
+ * \param flat use the hash map storage
+ * \param rng random number generator
+ */
+void
+BenchAlloc(uint32_t routes, bool flat, std::mt19937& rng)
+{
+    const uint32_t packets = 10000;
+    std::uniform_int_distribution<uint32_t> pick(0, routes - 1);
+
+    RoutingTable table(Seconds(15));
+    table.SetFlatStorage(flat);
+    // Long lived routes, so that none expires during the measurement. Every other route has
+    // two paths.
+    for (uint32_t i = 0; i < routes; ++i)
+    {
+        RoutingTableEntry rt = MakeRoute(Destination(i), Destination(i % 16), Seconds(1000));
+        table.AddRoute(rt);
+        if (i % 2 == 0)
+        {
+            table.ModifyRoute(Destination(i), [i](RoutingTableEntry& entry) {
+                entry.AddAlternate(Destination((i + 1) % 16),
+                                   /*dev=*/nullptr,
+                                   Ipv4InterfaceAddress(),
+                                   /*hops=*/3,
+                                   /*maxPaths=*/2);
+            });
+        }
+    }
+    // Warm-up: build the route handed to IP of every path, then let the expiry queue reach
+    // its capacity
+    for (uint32_t k = 0; k < 4 * routes; ++k)
+    {
+        AdvanceTime(MilliSeconds(1));
+        Ipv4Address dst = Destination(k < 2 * routes ? k / 2 : pick(rng));
+        ForwardPacket(table, Destination(pick(rng)), dst, k);
+    }
+
+    uint64_t hitAllocations = 0;
+    uint64_t missAllocations = 0;
+    for (uint32_t k = 0; k < packets; ++k)
+    {
+        AdvanceTime(MilliSeconds(1));
+        Ipv4Address origin = Destination(pick(rng));
+        Ipv4Address dst = Destination(pick(rng));
+        uint32_t flow = rng();
+        uint64_t before = g_allocations;
+        ForwardPacket(table, origin, dst, flow);
+        hitAllocations += g_allocations - before;
+
+        before = g_allocations;
+        RoutingTableEntry rt;
+        table.LookupRoute(Destination(routes + pick(rng)), rt);
+        missAllocations += g_allocations - before;
+    }
+    Simulator::Destroy();
+    std::cout << "routes,packets,route_hit_allocations,missed_lookup_allocations" << std::endl;
+    std::cout << routes << "," << packets << "," << hitAllocations << "," << missAllocations
+              << std::endl;
+    NS_ABORT_MSG_IF(hitAllocations != 0 || missAllocations != 0,
+                    "Route-hit forwarding or missed lookups allocate on the heap");
+}
+
+/**
+ * The invalidate benchmark, see the file comment
+ * \param routes number of routes
+ * \param unreachableCount number of unreachable destinations per RERR
+ * \param flat use the hash map storage
+ * \param rng random number generator
+ * \returns the mean cost of InvalidateRoutesWithDst() in ns
+ */
+double
+BenchInvalidate(uint32_t routes, uint32_t unreachableCount, bool flat, std::mt19937& rng)
+{
+    const uint32_t rounds = 1000;
+    std::uniform_int_distribution<uint32_t> pick(0, routes - 1);
+    unreachableCount = std::min(unreachableCount, routes);
+
+    RoutingTable table(Seconds(15));
+    table.SetFlatStorage(flat);
+    for (uint32_t i = 0; i < routes; ++i)
+    {
+        DiscoverRoute(table, Destination(i), rng);
+    }
+    double ns = 0;
+    for (uint32_t r = 0; r < rounds; ++r)
+    {
+        std::map<Ipv4Address, uint32_t> unreachable;
+        while (unreachable.size() < unreachableCount)
+        {
+            unreachable.insert(std::make_pair(Destination(pick(rng)), 2));
+        }
+        auto start = BenchClock::now();
+        table.InvalidateRoutesWithDst(unreachable);
+        ns += ElapsedNs(start);
+        for (auto i = unreachable.begin(); i != unreachable.end(); ++i)
+        {
+            DiscoverRoute(table, i->first, rng);
+        }
+    }
+    Simulator::Destroy();
+    return ns / rounds;
+}
+
+} // namespace
+
+int
+main(int argc, char* argv[])
+{
+    std::string bench = "lookup";
+    bool flat = false;
+    uint32_t maxRoutes = 10000;
+    uint32_t routes = 1000;
+    uint32_t unreachable = 100;
+    uint32_t seed = 1;
+
+    CommandLine cmd(__FILE__);
+    cmd.AddValue("bench", "Benchmark to run: lookup, invalidate, sweep, expire or alloc", bench);
+    cmd.AddValue("flat", "Use the hash map storage of the routing table", flat);
+    cmd.AddValue("maxRoutes",
+                 "Largest number of routes of the lookup, sweep and expire benchmarks",
+                 maxRoutes);
+    cmd.AddValue("routes", "Number of routes of the invalidate and alloc benchmarks", routes);
+    cmd.AddValue("unreachable", "Unreachable destinations per RERR", unreachable);
+    cmd.AddValue("seed", "Seed of the random destinations and lifetimes", seed);
+    cmd.Parse(argc, argv);
+
+    std::mt19937 rng(seed);
+    if (bench == "lookup")
+    {
+        std::cout << "routes,ns_per_packet" << std::endl;
+        for (uint32_t size = 10; size <= maxRoutes; size *= 10)
+        {
+            std::cout << size << "," << BenchLookup(size, flat, rng) << std::endl;
+        }
+    }
+    else if (bench == "sweep")
+    {
+        std::cout << "routes,ns_per_purge" << std::endl;
+        for (uint32_t size = 10; size <= maxRoutes; size *= 10)
+        {
+            std::cout << size << "," << BenchSweep(size, flat, rng) << std::endl;
+        }
+    }
+    else if (bench == "expire")
+    {
+        std::cout << "routes,ns_per_route" << std::endl;
+        for (uint32_t size = 10; size <= maxRoutes; size *= 10)
+        {
+            std::cout << size << "," << BenchExpire(size, flat, rng) << std::endl;
+        }
+    }
+    else if (bench == "alloc")
+    {
+        BenchAlloc(routes, flat, rng);
+    }
+    else if (bench == "invalidate")
+    {
+        std::cout << "routes,unreachable,ns_per_rerr" << std::endl;
+        std::cout << routes << "," << unreachable << ","
+                  << BenchInvalidate(routes, unreachable, flat, rng) << std::endl;
+    }
+    else
+    {
+        NS_FATAL_ERROR("Unknown benchmark " << bench);
+    }
+    return 0;
+}
@@ -4,6 +4,21 @@ declare -a nodes=(20 40 70 100)
 declare -a speeds=(5 10 15 20)
 declare -a packet_rates=(100 200 300 400)
 
+# Print the change of each metric of a variant sweep against its baseline sweep, matched on the
+# swept parameter, and save it as CSV: compare_sweeps <baseline> <variant> <column> <output>
+compare_sweeps()
+{
+	awk -F, -v key="$3" '
+		FNR == 1 { next }
+		NR == FNR { base[$key] = $0; next }
+		$key in base {
+			split(base[$key], b, ",")
+			print $key "," $4 - b[4] "," $6 - b[6] "," $7 - b[7] "," $8 - b[8]
+		}' "$1" "$2" |
+	(echo "value,packet_delivery_ratio_delta,avg_delay_delta,throughput_delta,control_bytes_delta"; cat) |
+	tee "$4"
+}
+
 for node in "${nodes[@]}"
 do
 	speed=20
@@ -28,3 +43,44 @@ do
 	echo "Running simulation with 40 nodes, 10 m/s speed, $packet_rate packets/s"
     ./ns3 run "2005104_task1 --CSVfileName=scratch/demo/2005104_aodv_packetRate.csv --nWifis=$node --nodeSpeed=$speed --packetsPerSecond=$packet_rate"
 done
+
+# Gossip-style RREQ forwarding under congestion, to compare against the packet rate sweep above
+for packet_rate in "${packet_rates[@]}"
+do
+	node=50
+	speed=20
+	echo "Running simulation with gossip forwarding, $node nodes, $speed m/s speed, $packet_rate packets/s"
+    ./ns3 run "2005104_task1 --CSVfileName=scratch/demo/2005104_aodv_packetRate_gossip.csv --nWifis=$node --nodeSpeed=$speed --packetsPerSecond=$packet_rate --gossip=1"
+done
+compare_sweeps scratch/demo/2005104_aodv_packetRate.csv scratch/demo/2005104_aodv_packetRate_gossip.csv 3 scratch/demo/2005104_aodv_packetRate_gossip_delta.csv
+
+# Counter-based RREQ rebroadcast suppression, to compare against the node sweep above
+for node in "${nodes[@]}"
+do
+	speed=20
+	packet_rate=4
+	echo "Running simulation with RREQ suppression, $node nodes, $speed m/s speed, $packet_rate packets/s"
+    ./ns3 run "2005104_task1 --CSVfileName=scratch/demo/2005104_aodv_nodes_suppression.csv --nWifis=$node --nodeSpeed=$speed --packetsPerSecond=$packet_rate --rreqSuppression=3"
+done
+compare_sweeps scratch/demo/2005104_aodv_nodes.csv scratch/demo/2005104_aodv_nodes_suppression.csv 1 scratch/demo/2005104_aodv_nodes_suppression_delta.csv
+
+# Multi-destination RREQs, to compare against the node sweep above
+for node in "${nodes[@]}"
+do
+	speed=20
+	packet_rate=4
+	echo "Running simulation with RREQ batching, $node nodes, $speed m/s speed, $packet_rate packets/s"
+    ./ns3 run "2005104_task1 --CSVfileName=scratch/demo/2005104_aodv_nodes_batch.csv --nWifis=$node --nodeSpeed=$speed --packetsPerSecond=$packet_rate --rreqBatch=20"
+done
+compare_sweeps scratch/demo/2005104_aodv_nodes.csv scratch/demo/2005104_aodv_nodes_batch.csv 1 scratch/demo/2005104_aodv_nodes_batch_delta.csv
+
+# RERR coalescing, to compare against the speed sweep above
+for speed in "${speeds[@]}"
+do
+	node=50
+	packet_rate=4
+	echo "Running simulation with RERR coalescing, $node nodes, $speed m/s speed, $packet_rate packets/s"
+    ./ns3 run "2005104_task1 --CSVfileName=scratch/demo/2005104_aodv_speed_coalescing.csv --nWifis=$node --nodeSpeed=$speed --packetsPerSecond=$packet_rate --rerrCoalescing=20"
+done
+compare_sweeps scratch/demo/2005104_aodv_speed.csv scratch/demo/2005104_aodv_speed_coalescing.csv 2 scratch/demo/2005104_aodv_speed_coalescing_delta.csv
+
@@ -111,6 +111,46 @@ class RoutingExperiment
      * Compute the throughput.
      */
     void CheckThroughput();
+    /**
+     * Count an RREQ dropped by a node because of congestion.
+     * \param context The trace context.
+     * \param header The RREQ header.
+     */
+    void RreqCongestionDrop(std::string context, const aodv::RreqHeader& header);
+    /**
+     * Count a congested RREP received by a node.
+     * \param context The trace context.
+     * \param neighbor The neighbor the RREP came from.
+     * \param congestion The congestion estimate of the neighbor.
+     */
+    void CongestedRrep(std::string context, Ipv4Address neighbor, double congestion);
+    /**
+     * Count a neighbor congestion estimate cleared by a node.
+     * \param context The trace context.
+     * \param neighbor The neighbor.
+     * \param congestion The congestion estimate cleared.
+     */
+    void CongestionCleared(std::string context, Ipv4Address neighbor, double congestion);
+    /**
+     * Count the AODV control packet bytes, IP and UDP headers included, sent by a node.
+     * \param packet The packet, with its IPv4 header.
+     * \param ipv4 The IPv4 stack of the node.
+     * \param interface The interface the packet is sent on.
+     */
+    void AodvControlTx(Ptr<const Packet> packet, Ptr<Ipv4> ipv4, uint32_t interface);
+    /**
+     * Write the congestion estimate and counters of each active AODV node to the congestion
+     * trace file, reset the counters and reschedule itself every second.
+     */
+    void WriteCongestionTrace();
+
+    /// Congestion events of a node during the current second.
+    struct CongestionCounters
+    {
+        uint32_t rreqDrops{0};      //!< RREQs dropped because of congestion.
+        uint32_t congestedRreps{0}; //!< Congested RREPs received.
+        uint32_t cleared{0};        //!< Neighbor congestion estimates cleared.
+    };
 
     uint32_t port{9};            //!< Receiving port number.
     uint32_t bytesTotal{0};      //!< Total received bytes.
@@ -127,6 +167,14 @@ class RoutingExperiment
     int nWifis{50};
     int nodeSpeed{5};
     int packet_per_sec{100};
+    bool m_gossip{false};                                  //!< Gossip-style RREQ forwarding.
+    uint32_t m_rreqSuppression{0}; //!< RREQ copies that cancel its rebroadcast, 0 for none.
+    uint32_t m_rreqBatch{0};       //!< RREQ batching window in ms, 0 for none.
+    uint32_t m_rerrCoalescing{0};  //!< RERR coalescing window in ms, 0 for none.
+    std::string m_congestionTraceFile; //!< Per node congestion trace file, empty for none.
+    std::vector<CongestionCounters> m_congestionCounters; //!< Congestion counters per node.
+    uint64_t m_controlBytes{0}; //!< AODV control bytes sent by all nodes.
+    uint32_t m_rrepsSent{0};    //!< RREPs, hellos included, sent by all nodes.
     bool is_new_file{true};
 };
 
@@ -197,6 +245,82 @@ RoutingExperiment::CheckThroughput()
 }
 
 
+// Extracts the node id from a trace context such as "/NodeList/3/$ns3::aodv::RoutingProtocol/...".
+static uint32_t
+ContextToNodeId(const std::string& context)
+{
+    std::size_t start = context.find('/', 1) + 1;
+    return std::stoul(context.substr(start, context.find('/', start) - start));
+}
+
+void
+RoutingExperiment::RreqCongestionDrop(std::string context, const aodv::RreqHeader& header)
+{
+    m_congestionCounters[ContextToNodeId(context)].rreqDrops++;
+}
+
+void
+RoutingExperiment::CongestedRrep(std::string context, Ipv4Address neighbor, double congestion)
+{
+    m_congestionCounters[ContextToNodeId(context)].congestedRreps++;
+}
+
+void
+RoutingExperiment::CongestionCleared(std::string context, Ipv4Address neighbor, double congestion)
+{
+    m_congestionCounters[ContextToNodeId(context)].cleared++;
+}
+
+// Adds the size of each AODV packet sent to m_controlBytes, and counts the RREPs and hellos.
+void
+RoutingExperiment::AodvControlTx(Ptr<const Packet> packet, Ptr<Ipv4> ipv4, uint32_t interface)
+{
+    Ptr<Packet> copy = packet->Copy();
+    Ipv4Header ipHeader;
+    copy->RemoveHeader(ipHeader);
+    if (ipHeader.GetProtocol() != UdpL4Protocol::PROT_NUMBER)
+    {
+        return;
+    }
+    UdpHeader udpHeader;
+    copy->RemoveHeader(udpHeader);
+    if (udpHeader.GetDestinationPort() != aodv::RoutingProtocol::AODV_PORT)
+    {
+        return;
+    }
+    m_controlBytes += packet->GetSize();
+    aodv::TypeHeader typeHeader;
+    copy->PeekHeader(typeHeader);
+    if (typeHeader.IsValid() && typeHeader.Get() == aodv::AODVTYPE_RREP)
+    {
+        m_rrepsSent++;
+    }
+}
+
+// Writes one line per node that is congested or saw a congestion event during the last second:
+// time, node, congestion estimate, RREQs dropped, congested RREPs, estimates cleared.
+// Reschedules itself to run every second.
+void
+RoutingExperiment::WriteCongestionTrace()
+{
+    std::ofstream out(m_congestionTraceFile, std::ios::app);
+    for (uint32_t i = 0; i < m_congestionCounters.size(); i++)
+    {
+        Ptr<aodv::RoutingProtocol> aodv = NodeList::GetNode(i)->GetObject<aodv::RoutingProtocol>();
+        double congestion = aodv ? aodv->GetCongestion() : 0;
+        CongestionCounters& counters = m_congestionCounters[i];
+        if (congestion > 0 || counters.rreqDrops || counters.congestedRreps || counters.cleared)
+        {
+            out << Simulator::Now().GetSeconds() << "," << i << "," << congestion << ","
+                << counters.rreqDrops << "," << counters.congestedRreps << "," << counters.cleared
+                << std::endl;
+        }
+        counters = CongestionCounters();
+    }
+    out.close();
+    Simulator::Schedule(Seconds(1.0), &RoutingExperiment::WriteCongestionTrace, this);
+}
+
 // Configures a socket on a node to receive packets sent to the specified IP address and port.
 Ptr<Socket>
 RoutingExperiment::SetupPacketReceive(Ipv4Address addr, Ptr<Node> node)
@@ -227,6 +351,23 @@ RoutingExperiment::CommandSetup(int argc, char** argv)
     cmd.AddValue("nWifis", "Number of wifi nodes", nWifis);
     cmd.AddValue("nodeSpeed", "Speed of nodes", nodeSpeed);
     cmd.AddValue("packetsPerSecond", "Number of packets per second", packet_per_sec);
+    cmd.AddValue("gossip",
+                 "Rebroadcast RREQs with a probability falling with congestion instead of "
+                 "dropping them all above the threshold",
+                 m_gossip);
+    cmd.AddValue("rreqSuppression",
+                 "Number of copies of an RREQ, the first included, that cancel its "
+                 "rebroadcast, 0 for none",
+                 m_rreqSuppression);
+    cmd.AddValue("rreqBatch",
+                 "Window in ms for discovering new destinations with one RREQ, 0 for none",
+                 m_rreqBatch);
+    cmd.AddValue("rerrCoalescing",
+                 "Window in ms for merging unreachable destinations into one RERR, 0 for none",
+                 m_rerrCoalescing);
+    cmd.AddValue("congestionTrace",
+                 "File to write the AODV congestion estimate and events to, per node per second",
+                 m_congestionTraceFile);
     cmd.Parse(argc, argv);
 
     std::vector<std::string> allowedProtocols{"OLSR", "AODV", "DSDV", "DSR"};
@@ -247,7 +388,9 @@ void write_FM_to_CSV(Ptr<FlowMonitor> flow_monitor,
                      FlowMonitorHelper& flow_helper,
                      std::string file_name,int nWifis,
                      int nodeSpeed,
-                     int packet_per_sec)
+                     int packet_per_sec,
+                     uint64_t control_bytes,
+                     uint32_t rreps_sent)
 {
     std::ofstream csv_file;
     csv_file.open(file_name,std::ios::app);
@@ -277,7 +420,7 @@ void write_FM_to_CSV(Ptr<FlowMonitor> flow_monitor,
     double packet_drop_ratio = (double)total_dropped_packets/(double)total_sent_packets;
     double avg_delay = total_delay/(double)total_received_packets;
     double throughput = (double)(total_received_packets*64*8.0)/((200.0-100.0)*1000.0);
-    csv_file <<nWifis<<","<<nodeSpeed<<","<<packet_per_sec<<","<<packet_delivery_ratio<<","<<packet_drop_ratio<<","<<avg_delay<<","<<throughput<<std::endl;
+    csv_file <<nWifis<<","<<nodeSpeed<<","<<packet_per_sec<<","<<packet_delivery_ratio<<","<<packet_drop_ratio<<","<<avg_delay<<","<<throughput<<","<<control_bytes<<","<<rreps_sent<<std::endl;
     csv_file.close();
 }
 
@@ -336,7 +479,9 @@ RoutingExperiment::Run()
               << "packet_delivery_ratio,"
               << "packet_drop_ratio,"
               << "avg_delay,"
-              << "throughput" << std::endl;
+              << "throughput,"
+              << "control_bytes,"
+              << "rreps_sent" << std::endl;
         out1.close();
     }
     //int nWifis = 50;
@@ -409,6 +554,10 @@ RoutingExperiment::Run()
     streamIndex += mobilityAdhoc.AssignStreams(adhocNodes, streamIndex);
 
     AodvHelper aodv;
+    aodv.Set("GossipForwarding", BooleanValue(m_gossip));
+    aodv.Set("RreqSuppressionCount", UintegerValue(m_rreqSuppression));
+    aodv.Set("RreqBatchWindow", TimeValue(MilliSeconds(m_rreqBatch)));
+    aodv.Set("RerrCoalescingWindow", TimeValue(MilliSeconds(m_rerrCoalescing)));
     OlsrHelper olsr;
     DsdvHelper dsdv;
     DsrHelper dsr;
@@ -514,12 +663,40 @@ RoutingExperiment::Run()
 
     CheckThroughput();
 
+    if (m_protocolName == "AODV" && !m_congestionTraceFile.empty())
+    {
+        std::ofstream congestionOut(m_congestionTraceFile);
+        congestionOut << "time,node,congestion,rreqDrops,congestedRreps,cleared" << std::endl;
+        congestionOut.close();
+        m_congestionCounters.resize(nWifis);
+        Config::Connect("/NodeList/*/$ns3::aodv::RoutingProtocol/RreqCongestionDrop",
+                        MakeCallback(&RoutingExperiment::RreqCongestionDrop, this));
+        Config::Connect("/NodeList/*/$ns3::aodv::RoutingProtocol/NeighborCongestion",
+                        MakeCallback(&RoutingExperiment::CongestedRrep, this));
+        Config::Connect("/NodeList/*/$ns3::aodv::RoutingProtocol/NeighborCongestionCleared",
+                        MakeCallback(&RoutingExperiment::CongestionCleared, this));
+        Simulator::Schedule(Seconds(1.0), &RoutingExperiment::WriteCongestionTrace, this);
+    }
+
+    if (m_protocolName == "AODV")
+    {
+        Config::ConnectWithoutContext("/NodeList/*/$ns3::Ipv4L3Protocol/Tx",
+                                      MakeCallback(&RoutingExperiment::AodvControlTx, this));
+    }
+
     Simulator::Stop(Seconds(TotalTime));
     Simulator::Run();
 
     if (m_flowMonitor)
     {   
-        write_FM_to_CSV(flowmon, flowmonHelper, aodv_CSVfileName,nWifis,nodeSpeed,packet_per_sec);
+        write_FM_to_CSV(flowmon,
+                        flowmonHelper,
+                        aodv_CSVfileName,
+                        nWifis,
+                        nodeSpeed,
+                        packet_per_sec,
+                        m_controlBytes,
+                        m_rrepsSent);
         //flowmon->SerializeToXmlFile("scratch/demo"+tr_name + ".flowmon", true, true);
     }
 
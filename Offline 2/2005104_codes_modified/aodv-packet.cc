@@ -18,6 +18,12 @@
 #include "ns3/address-utils.h"
 #include "ns3/packet.h"
 
+#include <algorithm>
+
+/// Reserved bits of the RREP flags that carry the load level
+#define LOAD_LEVEL_MASK 0x03
+static_assert((MAX_LOAD_LEVEL & ~LOAD_LEVEL_MASK) == 0, "The load level must fit its flag bits");
+
 namespace ns3
 {
 namespace aodv
@@ -299,7 +305,7 @@ RrepHeader::RrepHeader(uint8_t prefixSize,
       m_origin(origin)
 {
     m_lifeTime = uint32_t(lifeTime.GetMilliSeconds());
-    m_congestion_flag=congestion_flag;
+    Set_congestion_flag(congestion_flag);
 }
 
 NS_OBJECT_ENSURE_REGISTERED(RrepHeader);
@@ -323,7 +329,7 @@ RrepHeader::GetInstanceTypeId() const
 uint32_t
 RrepHeader::GetSerializedSize() const
 {
-    return 19+4;
+    return 19;
 }
 
 void
@@ -336,7 +342,6 @@ RrepHeader::Serialize(Buffer::Iterator i) const
     i.WriteHtonU32(m_dstSeqNo);
     WriteTo(i, m_origin);
     i.WriteHtonU32(m_lifeTime);
-    i.WriteHtonU32(m_congestion_flag);
 }
 
 uint32_t
@@ -351,7 +356,6 @@ RrepHeader::Deserialize(Buffer::Iterator start)
     m_dstSeqNo = i.ReadNtohU32();
     ReadFrom(i, m_origin);
     m_lifeTime = i.ReadNtohU32();
-    m_congestion_flag=i.ReadNtohU32();
 
     uint32_t dist = i.GetDistanceFrom(start);
     NS_ASSERT(dist == GetSerializedSize());
@@ -366,9 +370,9 @@ RrepHeader::Print(std::ostream& os) const
     {
         os << " prefix size " << m_prefixSize;
     }
-    os << " source ipv4 " << m_origin << " lifetime " << m_lifeTime<<
-          " congestion flag "<<m_congestion_flag
-       << " acknowledgment required flag " << (*this).GetAckRequired();
+    os << " source ipv4 " << m_origin << " lifetime " << m_lifeTime << " congestion flag "
+       << Get_congestion_flag() << " acknowledgment required flag "
+       << (*this).GetAckRequired();
 }
 
 void
@@ -387,13 +391,14 @@ RrepHeader::GetLifeTime() const
 void
 RrepHeader::Set_congestion_flag(int32_t congestion_flag)
 {
-    m_congestion_flag = congestion_flag;
+    int32_t level = std::min(std::max(congestion_flag, 0), MAX_LOAD_LEVEL);
+    m_flags = (m_flags & ~LOAD_LEVEL_MASK) | uint8_t(level);
 }
 
-int32_t 
+int32_t
 RrepHeader::Get_congestion_flag() const
 {
-    return m_congestion_flag;
+    return m_flags & LOAD_LEVEL_MASK;
 }
 
 void
@@ -432,7 +437,7 @@ RrepHeader::operator==(const RrepHeader& o) const
 {
     return (m_flags == o.m_flags && m_prefixSize == o.m_prefixSize && m_hopCount == o.m_hopCount &&
             m_dst == o.m_dst && m_dstSeqNo == o.m_dstSeqNo && m_origin == o.m_origin &&
-            m_lifeTime == o.m_lifeTime && m_congestion_flag==o.m_congestion_flag);
+            m_lifeTime == o.m_lifeTime);
 }
 
 void
@@ -627,7 +632,10 @@ RerrHeader::AddUnDestination(Ipv4Address dst, uint32_t seqNo)
         return true;
     }
 
-    NS_ASSERT(GetDestCount() < 255); // can't support more than 255 destinations in single RERR
+    if (GetDestCount() == 255) // can't support more than 255 destinations in single RERR
+    {
+        return false;
+    }
     m_unreachableDstSeqNo.insert(std::make_pair(dst, seqNo));
     return true;
 }
@@ -682,5 +690,215 @@ operator<<(std::ostream& os, const RerrHeader& h)
     h.Print(os);
     return os;
 }
+//-----------------------------------------------------------------------------
+// Load extension
+//-----------------------------------------------------------------------------
+
+LoadExtensionHeader::LoadExtensionHeader(double queueFill, double macDrops, uint8_t loadLevel)
+    : m_queueFill(uint8_t(std::min(std::max(queueFill, 0.0), 1.0) * 255 + 0.5)),
+      m_macDrops(uint8_t(std::min(std::max(macDrops, 0.0), 255.0) + 0.5)),
+      m_loadLevel(loadLevel),
+      m_valid(true)
+{
+}
+
+NS_OBJECT_ENSURE_REGISTERED(LoadExtensionHeader);
+
+TypeId
+LoadExtensionHeader::GetTypeId()
+{
+    static TypeId tid = TypeId("ns3::aodv::LoadExtensionHeader")
+                            .SetParent<Header>()
+                            .SetGroupName("Aodv")
+                            .AddConstructor<LoadExtensionHeader>();
+    return tid;
+}
+
+TypeId
+LoadExtensionHeader::GetInstanceTypeId() const
+{
+    return GetTypeId();
+}
+
+uint32_t
+LoadExtensionHeader::GetSerializedSize() const
+{
+    return 5;
+}
+
+void
+LoadExtensionHeader::Serialize(Buffer::Iterator i) const
+{
+    i.WriteU8(AODVEXT_LOAD);
+    i.WriteU8(3);
+    i.WriteU8(m_queueFill);
+    i.WriteU8(m_macDrops);
+    i.WriteU8(m_loadLevel);
+}
+
+uint32_t
+LoadExtensionHeader::Deserialize(Buffer::Iterator start)
+{
+    Buffer::Iterator i = start;
+    uint8_t type = i.ReadU8();
+    uint8_t length = i.ReadU8();
+    m_valid = (type == AODVEXT_LOAD && length == 3);
+    m_queueFill = i.ReadU8();
+    m_macDrops = i.ReadU8();
+    m_loadLevel = i.ReadU8();
+
+    uint32_t dist = i.GetDistanceFrom(start);
+    NS_ASSERT(dist == GetSerializedSize());
+    return dist;
+}
+
+void
+LoadExtensionHeader::Print(std::ostream& os) const
+{
+    os << "queue fill " << GetQueueFill() << " MAC drops " << uint32_t(m_macDrops)
+       << " load level " << uint32_t(m_loadLevel);
+}
+
+bool
+LoadExtensionHeader::operator==(const LoadExtensionHeader& o) const
+{
+    return (m_queueFill == o.m_queueFill && m_macDrops == o.m_macDrops &&
+            m_loadLevel == o.m_loadLevel && m_valid == o.m_valid);
+}
+
+std::ostream&
+operator<<(std::ostream& os, const LoadExtensionHeader& h)
+{
+    h.Print(os);
+    return os;
+}
+
+//-----------------------------------------------------------------------------
+// Destinations extension
+//-----------------------------------------------------------------------------
+
+DestinationsExtensionHeader::DestinationsExtensionHeader()
+    : m_valid(true)
+{
+}
+
+NS_OBJECT_ENSURE_REGISTERED(DestinationsExtensionHeader);
+
+TypeId
+DestinationsExtensionHeader::GetTypeId()
+{
+    static TypeId tid = TypeId("ns3::aodv::DestinationsExtensionHeader")
+                            .SetParent<Header>()
+                            .SetGroupName("Aodv")
+                            .AddConstructor<DestinationsExtensionHeader>();
+    return tid;
+}
+
+TypeId
+DestinationsExtensionHeader::GetInstanceTypeId() const
+{
+    return GetTypeId();
+}
+
+uint32_t
+DestinationsExtensionHeader::GetSerializedSize() const
+{
+    return 2 + 9 * m_destinations.size();
+}
+
+void
+DestinationsExtensionHeader::Serialize(Buffer::Iterator i) const
+{
+    i.WriteU8(AODVEXT_DESTINATIONS);
+    i.WriteU8(9 * m_destinations.size());
+    for (auto j = m_destinations.begin(); j != m_destinations.end(); ++j)
+    {
+        i.WriteU8(j->unknownSeqno ? (1 << 7) : 0);
+        WriteTo(i, j->dst);
+        i.WriteHtonU32(j->seqNo);
+    }
+}
+
+uint32_t
+DestinationsExtensionHeader::Deserialize(Buffer::Iterator start)
+{
+    Buffer::Iterator i = start;
+    m_destinations.clear();
+    uint8_t type = i.ReadU8();
+    uint8_t length = i.ReadU8();
+    m_valid = (type == AODVEXT_DESTINATIONS && length % 9 == 0 && i.GetRemainingSize() >= length);
+    if (!m_valid)
+    {
+        return i.GetDistanceFrom(start);
+    }
+    for (uint8_t k = 0; k < length / 9; ++k)
+    {
+        Destination destination;
+        destination.unknownSeqno = (i.ReadU8() & (1 << 7));
+        ReadFrom(i, destination.dst);
+        destination.seqNo = i.ReadNtohU32();
+        m_destinations.push_back(destination);
+    }
+
+    uint32_t dist = i.GetDistanceFrom(start);
+    NS_ASSERT(dist == GetSerializedSize());
+    return dist;
+}
+
+void
+DestinationsExtensionHeader::Print(std::ostream& os) const
+{
+    os << "Additional destinations: ipv4 address, seq. number:";
+    for (auto j = m_destinations.begin(); j != m_destinations.end(); ++j)
+    {
+        os << j->dst << ", ";
+        if (j->unknownSeqno)
+        {
+            os << "unknown; ";
+        }
+        else
+        {
+            os << j->seqNo << "; ";
+        }
+    }
+}
+
+bool
+DestinationsExtensionHeader::AddDestination(Ipv4Address dst, uint32_t seqNo, bool unknownSeqno)
+{
+    if (m_destinations.size() >= MAX_DESTINATIONS)
+    {
+        return false;
+    }
+    m_destinations.push_back({dst, seqNo, unknownSeqno});
+    return true;
+}
+
+bool
+DestinationsExtensionHeader::operator==(const DestinationsExtensionHeader& o) const
+{
+    if (m_destinations.size() != o.m_destinations.size() || m_valid != o.m_valid)
+    {
+        return false;
+    }
+    for (std::size_t k = 0; k < m_destinations.size(); ++k)
+    {
+        const Destination& a = m_destinations[k];
+        const Destination& b = o.m_destinations[k];
+        if (a.dst != b.dst || a.seqNo != b.seqNo || a.unknownSeqno != b.unknownSeqno)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::ostream&
+operator<<(std::ostream& os, const DestinationsExtensionHeader& h)
+{
+    h.Print(os);
+    return os;
+}
+
 } // namespace aodv
 } // namespace ns3
@@ -23,6 +23,10 @@
 
 #include <iostream>
 #include <map>
+#include <vector>
+
+/// Highest load level, as carried in the RREP flags
+#define MAX_LOAD_LEVEL 3
 
 namespace ns3
 {
@@ -41,6 +45,16 @@ enum MessageType
     AODVTYPE_RREP_ACK = 4 //!< AODVTYPE_RREP_ACK
 };
 
+/**
+ * \ingroup aodv
+ * \brief ExtensionType enumeration
+ */
+enum ExtensionType
+{
+    AODVEXT_LOAD = 128,        //!< AODVEXT_LOAD
+    AODVEXT_DESTINATIONS = 129 //!< AODVEXT_DESTINATIONS
+};
+
 /**
  * \ingroup aodv
  * \brief AODV types
@@ -355,6 +369,7 @@ class RrepHeader : public Header
      * \param dstSeqNo the destination sequence number
      * \param origin the origin IP address
      * \param lifetime the lifetime
+     * \param congestion_flag the load level, from 0 to MAX_LOAD_LEVEL
      */
     RrepHeader(uint8_t prefixSize = 0,
                uint8_t hopCount = 0,
@@ -458,7 +473,16 @@ class RrepHeader : public Header
      */
     Time GetLifeTime() const;
 
+    /**
+     * \brief Set the load level, carried in the two low reserved bits of the flags. Levels above
+     * MAX_LOAD_LEVEL are sent as MAX_LOAD_LEVEL.
+     * \param congestion_flag the load level
+     */
     void Set_congestion_flag(int32_t congestion_flag);
+    /**
+     * \brief Get the load level
+     * \return the load level, from 0 to MAX_LOAD_LEVEL
+     */
     int32_t Get_congestion_flag() const;
 
     // Flags
@@ -500,14 +524,13 @@ class RrepHeader : public Header
     bool operator==(const RrepHeader& o) const;
 
   private:
-    uint8_t m_flags;      ///< A - acknowledgment required flag
+    uint8_t m_flags;      ///< A - acknowledgment required flag, load level in the low bits
     uint8_t m_prefixSize; ///< Prefix Size
     uint8_t m_hopCount;   ///< Hop Count
     Ipv4Address m_dst;    ///< Destination IP Address
     uint32_t m_dstSeqNo;  ///< Destination Sequence Number
     Ipv4Address m_origin; ///< Source IP Address
     uint32_t m_lifeTime;  ///< Lifetime (in milliseconds)
-    uint32_t m_congestion_flag;
 };
 
 /**
@@ -658,6 +681,194 @@ class RerrHeader : public Header
  */
 std::ostream& operator<<(std::ostream& os, const RerrHeader&);
 
+/**
+* \ingroup aodv
+* \brief Load extension, appended to Hello messages to summarize the load of the sender
+  \verbatim
+  0                   1                   2                   3
+  0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
+  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+  |     Type      |    Length     |  Queue Fill   |   MAC Drops   |
+  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+  |  Load Level   |
+  +-+-+-+-+-+-+-+-+
+  \endverbatim
+*/
+class LoadExtensionHeader : public Header
+{
+  public:
+    /**
+     * constructor
+     *
+     * \param queueFill the occupancy of the packet queue, from 0 to 1
+     * \param macDrops the number of recent MAC drops
+     * \param loadLevel the load level
+     */
+    LoadExtensionHeader(double queueFill = 0, double macDrops = 0, uint8_t loadLevel = 0);
+
+    /**
+     * \brief Get the type ID.
+     * \return the object TypeId
+     */
+    static TypeId GetTypeId();
+    TypeId GetInstanceTypeId() const override;
+    uint32_t GetSerializedSize() const override;
+    void Serialize(Buffer::Iterator start) const override;
+    uint32_t Deserialize(Buffer::Iterator start) override;
+    void Print(std::ostream& os) const override;
+
+    /**
+     * Check that the extension is a load extension
+     * \returns true if the type and length are those of a load extension
+     */
+    bool IsValid() const
+    {
+        return m_valid;
+    }
+
+    /**
+     * \brief Get the occupancy of the packet queue
+     * \return the occupancy, from 0 to 1
+     */
+    double GetQueueFill() const
+    {
+        return m_queueFill / 255.0;
+    }
+
+    /**
+     * \brief Get the number of recent MAC drops
+     * \return the number of drops, at most 255
+     */
+    uint8_t GetMacDrops() const
+    {
+        return m_macDrops;
+    }
+
+    /**
+     * \brief Get the load level
+     * \return the load level
+     */
+    uint8_t GetLoadLevel() const
+    {
+        return m_loadLevel;
+    }
+
+    /**
+     * \brief Comparison operator
+     * \param o load extension to compare
+     * \return true if the load extensions are equal
+     */
+    bool operator==(const LoadExtensionHeader& o) const;
+
+  private:
+    uint8_t m_queueFill; ///< Queue occupancy, in 255ths
+    uint8_t m_macDrops;  ///< Recent MAC drops, saturated at 255
+    uint8_t m_loadLevel; ///< Load level
+    bool m_valid;        ///< Indicates if the extension is a load extension
+};
+
+/**
+ * \brief Stream output operator
+ * \param os output stream
+ * \return updated stream
+ */
+std::ostream& operator<<(std::ostream& os, const LoadExtensionHeader&);
+
+/**
+* \ingroup aodv
+* \brief Destinations extension, appended to an RREQ to request routes to more destinations
+  \verbatim
+  0                   1                   2                   3
+  0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
+  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+  |     Type      |    Length     |U|  Reserved   |   Dst (1) ...
+  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+  ... Destination IP Address (1)  |   Dst Seq (1) ...
+  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+  ... Destination Sequence Number (1)             | Additional ...
+  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+  \endverbatim
+*/
+class DestinationsExtensionHeader : public Header
+{
+  public:
+    /// Destination requested in the extension
+    struct Destination
+    {
+        Ipv4Address dst;   ///< Destination IP Address
+        uint32_t seqNo;    ///< Destination Sequence Number
+        bool unknownSeqno; ///< Unknown sequence number flag
+    };
+
+    /// Maximum number of destinations that fit in the length field
+    static const uint32_t MAX_DESTINATIONS = 28;
+
+    /// constructor
+    DestinationsExtensionHeader();
+
+    /**
+     * \brief Get the type ID.
+     * \return the object TypeId
+     */
+    static TypeId GetTypeId();
+    TypeId GetInstanceTypeId() const override;
+    uint32_t GetSerializedSize() const override;
+    void Serialize(Buffer::Iterator start) const override;
+    uint32_t Deserialize(Buffer::Iterator start) override;
+    void Print(std::ostream& os) const override;
+
+    /**
+     * Check that the extension is a destinations extension
+     * \returns true if the type and length are those of a destinations extension
+     */
+    bool IsValid() const
+    {
+        return m_valid;
+    }
+
+    /**
+     * Add a destination
+     * \param dst the destination IP address
+     * \param seqNo the destination sequence number
+     * \param unknownSeqno the unknown sequence number flag
+     * \return false if the extension already holds MAX_DESTINATIONS destinations
+     */
+    bool AddDestination(Ipv4Address dst, uint32_t seqNo, bool unknownSeqno);
+
+    /**
+     * \brief Get the destinations
+     * \return the destinations, in the order in which they were added
+     */
+    const std::vector<Destination>& GetDestinations() const
+    {
+        return m_destinations;
+    }
+
+    /// Remove all the destinations
+    void Clear()
+    {
+        m_destinations.clear();
+    }
+
+    /**
+     * \brief Comparison operator
+     * \param o destinations extension to compare
+     * \return true if the destinations extensions are equal
+     */
+    bool operator==(const DestinationsExtensionHeader& o) const;
+
+  private:
+    std::vector<Destination> m_destinations; ///< Requested destinations
+    bool m_valid;                            ///< Indicates if the extension is valid
+};
+
+/**
+ * \brief Stream output operator
+ * \param os output stream
+ * \return updated stream
+ */
+std::ostream& operator<<(std::ostream& os, const DestinationsExtensionHeader&);
+
 } // namespace aodv
 } // namespace ns3
 
@@ -23,6 +23,7 @@
 
 #include "ns3/adhoc-wifi-mac.h"
 #include "ns3/boolean.h"
+#include "ns3/double.h"
 #include "ns3/inet-socket-address.h"
 #include "ns3/log.h"
 #include "ns3/pointer.h"
@@ -36,9 +37,11 @@
 #include "ns3/wifi-net-device.h"
 
 #include <algorithm>
+#include <cmath>
 #include <limits>
 
-#define MAX_CONGESTION_COUNT 4
+/// Congestion estimate below which a neighbor is forgotten
+#define MIN_NEIGHBOR_CONGESTION 0.01
 
 namespace ns3
 {
@@ -157,6 +160,8 @@ RoutingProtocol::RoutingProtocol()
       m_destinationOnly(false),
       m_gratuitousReply(true),
       m_enableHello(false),
+      m_multipathMaxPaths(1),
+      m_gatewayPrefixSize(0),
       m_routingTable(m_deletePeriod),
       m_queue(m_maxQueueLen, m_maxQueueTime),
       m_requestId(0),
@@ -166,10 +171,39 @@ RoutingProtocol::RoutingProtocol()
       m_nb(m_helloInterval),
       m_rreqCount(0),
       m_rerrCount(0),
-      m_congestion_count(0),
+      m_congestionDecayTime(Seconds(5)),
+      m_congestionThreshold(4),
+      m_congestedLoadLevel(2),
+      m_congestionUpdateInterval(Seconds(1)),
+      m_gossipForwarding(false),
+      m_gossipOnset(1),
+      m_gossipMinProbability(0.2),
+      m_rediscoveryLoadLevel(0),
+      m_replyCollectionWindow(Seconds(0)),
+      m_replyLoadWeight(1),
+      m_replyNeighborWeight(0.5),
+      m_helloLoadExtension(false),
+      m_rreqSuppressionCount(0),
+      m_rreqBatchWindow(Seconds(0)),
+      m_rerrCoalescingWindow(Seconds(0)),
+      m_congestion(0),
+      m_loadDropWindow(Seconds(1)),
+      m_loadDropThreshold(10),
+      m_recentMacDrops(0),
+      m_memoryBudget(0),
+      m_memoryCheckInterval(Seconds(0)),
+      m_routingTableMemory(0),
+      m_queueMemory(0),
+      m_rreqIdCacheMemory(0),
+      m_requestTimerMemory(0),
+      m_memoryUsage(0),
       m_htimer(Timer::CANCEL_ON_DESTROY),
       m_rreqRateLimitTimer(Timer::CANCEL_ON_DESTROY),
       m_rerrRateLimitTimer(Timer::CANCEL_ON_DESTROY),
+      m_rreqBatchTimer(Timer::CANCEL_ON_DESTROY),
+      m_rerrCoalescingTimer(Timer::CANCEL_ON_DESTROY),
+      m_memoryTimer(Timer::CANCEL_ON_DESTROY),
+      m_congestionTimer(Timer::CANCEL_ON_DESTROY),
       m_lastBcastTime(Seconds(0))
 {
     m_nb.SetCallback(MakeCallback(&RoutingProtocol::SendRerrWhenBreaksLinkToNextHop, this));
@@ -249,12 +283,117 @@ RoutingProtocol::GetTypeId()
                           TimeValue(Seconds(11.2)),
                           MakeTimeAccessor(&RoutingProtocol::m_myRouteTimeout),
                           MakeTimeChecker())
-
-            .AddAttribute("m_congestion_count","m_congestion_count.",
+            .AddAttribute("CongestionDecayTime",
+                          "Time constant of the exponential decay of the count of congested "
+                          "RREPs kept per neighbor. Must be positive.",
+                          TimeValue(Seconds(5)),
+                          MakeTimeAccessor(&RoutingProtocol::m_congestionDecayTime),
+                          MakeTimeChecker(NanoSeconds(1)))
+            .AddAttribute("CongestionThreshold",
+                          "Decayed count of congested RREPs, summed over the neighbors, above "
+                          "which RREQs are dropped and no intermediate RREP is sent through a "
+                          "neighbor.",
+                          DoubleValue(4),
+                          MakeDoubleAccessor(&RoutingProtocol::m_congestionThreshold),
+                          MakeDoubleChecker<double>(0))
+            .AddAttribute("CongestedLoadLevel",
+                          "Load level, as carried in RREPs and hellos, from which an RREP counts "
+                          "as congested and a neighbor as congested.",
+                          UintegerValue(2),
+                          MakeUintegerAccessor(&RoutingProtocol::m_congestedLoadLevel),
+                          MakeUintegerChecker<uint8_t>(1, MAX_LOAD_LEVEL))
+            .AddAttribute("CongestionUpdateInterval",
+                          "Period of the update of the Congestion trace source while congestion "
+                          "estimates decay. Must be positive.",
+                          TimeValue(Seconds(1)),
+                          MakeTimeAccessor(&RoutingProtocol::m_congestionUpdateInterval),
+                          MakeTimeChecker(NanoSeconds(1)))
+            .AddAttribute("GossipForwarding",
+                          "Rebroadcast RREQs under congestion with a probability falling with the "
+                          "congestion estimate instead of dropping them all above the threshold. "
+                          "The destination and nodes with a fresh route always reply.",
+                          BooleanValue(false),
+                          MakeBooleanAccessor(&RoutingProtocol::m_gossipForwarding),
+                          MakeBooleanChecker())
+            .AddAttribute("GossipOnset",
+                          "Congestion estimate up to which RREQs are always rebroadcast in gossip "
+                          "mode.",
+                          DoubleValue(1),
+                          MakeDoubleAccessor(&RoutingProtocol::m_gossipOnset),
+                          MakeDoubleChecker<double>(0))
+            .AddAttribute("GossipMinProbability",
+                          "Probability of rebroadcasting an RREQ in gossip mode once the "
+                          "congestion estimate reaches CongestionThreshold.",
+                          DoubleValue(0.2),
+                          MakeDoubleAccessor(&RoutingProtocol::m_gossipMinProbability),
+                          MakeDoubleChecker<double>(0, 1))
+            .AddAttribute("RediscoveryLoadLevel",
+                          "Load level reported for an active route, within the last "
+                          "ActiveRouteTimeout, from which the route is rediscovered while it "
+                          "stays in use. 0 disables proactive rediscovery.",
+                          UintegerValue(0),
+                          MakeUintegerAccessor(&RoutingProtocol::m_rediscoveryLoadLevel),
+                          MakeUintegerChecker<uint8_t>(0, MAX_LOAD_LEVEL))
+            .AddAttribute("ReplyCollectionWindow",
+                          "Time for which the originator of a route discovery keeps collecting "
+                          "RREPs after the first one, switching to the best route by hop count, "
+                          "load level and neighbor congestion, before sending the queued "
+                          "packets. 0 sends them on the first RREP.",
+                          TimeValue(Seconds(0)),
+                          MakeTimeAccessor(&RoutingProtocol::m_replyCollectionWindow),
+                          MakeTimeChecker())
+            .AddAttribute("ReplyLoadWeight",
+                          "Weight of the load level reported in an RREP when ranking collected "
+                          "replies, in hops per level.",
+                          DoubleValue(1),
+                          MakeDoubleAccessor(&RoutingProtocol::m_replyLoadWeight),
+                          MakeDoubleChecker<double>(0))
+            .AddAttribute("ReplyNeighborWeight",
+                          "Weight of the congestion estimate of the neighbor an RREP came from "
+                          "when ranking collected replies, in hops per congested RREP.",
+                          DoubleValue(0.5),
+                          MakeDoubleAccessor(&RoutingProtocol::m_replyNeighborWeight),
+                          MakeDoubleChecker<double>(0))
+            .AddAttribute("HelloLoadExtension",
+                          "Append the queue occupancy, recent MAC drops and load level to hello "
+                          "messages, and use those of the neighbors to skip RREQ rebroadcasts "
+                          "when all neighbors are congested and to steer flows off congested "
+                          "next hops.",
+                          BooleanValue(false),
+                          MakeBooleanAccessor(&RoutingProtocol::m_helloLoadExtension),
+                          MakeBooleanChecker())
+            .AddAttribute("RreqSuppressionCount",
+                          "Number of copies of an RREQ, the first one included, heard during the "
+                          "jitter before its rebroadcast, that cancel the rebroadcast. 0 never "
+                          "cancels it.",
                           UintegerValue(0),
-                          MakeUintegerAccessor(&
-                          RoutingProtocol::m_congestion_count),
+                          MakeUintegerAccessor(&RoutingProtocol::m_rreqSuppressionCount),
                           MakeUintegerChecker<uint32_t>())
+            .AddAttribute("RreqBatchWindow",
+                          "Time new destinations wait to be discovered together, by one RREQ "
+                          "carrying the others in a destinations extension. 0 sends an RREQ per "
+                          "destination.",
+                          TimeValue(Seconds(0)),
+                          MakeTimeAccessor(&RoutingProtocol::m_rreqBatchWindow),
+                          MakeTimeChecker())
+            .AddAttribute("RerrCoalescingWindow",
+                          "Time unreachable destinations wait to be reported together, in one "
+                          "RERR per interface split only beyond 255 destinations. 0 sends the "
+                          "RERRs immediately.",
+                          TimeValue(Seconds(0)),
+                          MakeTimeAccessor(&RoutingProtocol::m_rerrCoalescingWindow),
+                          MakeTimeChecker())
+            .AddAttribute("LoadDropWindow",
+                          "Time constant of the exponential decay of the MAC drop count that "
+                          "contributes to the load level advertised in RREPs. Must be positive.",
+                          TimeValue(Seconds(1)),
+                          MakeTimeAccessor(&RoutingProtocol::m_loadDropWindow),
+                          MakeTimeChecker(NanoSeconds(1)))
+            .AddAttribute("LoadDropThreshold",
+                          "Decayed MAC drop count at which the advertised load level is maximal.",
+                          UintegerValue(10),
+                          MakeUintegerAccessor(&RoutingProtocol::m_loadDropThreshold),
+                          MakeUintegerChecker<uint32_t>(1))
             .AddAttribute("BlackListTimeout",
                           "Time for which the node is put into the blacklist = RreqRetries * "
                           "NetTraversalTime",
@@ -330,11 +469,89 @@ RoutingProtocol::GetTypeId()
                           MakeBooleanAccessor(&RoutingProtocol::SetBroadcastEnable,
                                               &RoutingProtocol::GetBroadcastEnable),
                           MakeBooleanChecker())
+            .AddAttribute("FlatRoutingTable",
+                          "Indicates whether the routing table is stored in an open-addressing "
+                          "hash table keyed on the raw IPv4 address instead of a std::map.",
+                          BooleanValue(false),
+                          MakeBooleanAccessor(&RoutingProtocol::SetFlatRoutingTable,
+                                              &RoutingProtocol::GetFlatRoutingTable),
+                          MakeBooleanChecker())
+            .AddAttribute("MultipathMaxPaths",
+                          "Maximum number of loop-free equal-cost paths kept per destination. "
+                          "Forwarded flows are spread across them by hashing the flow.",
+                          UintegerValue(1),
+                          MakeUintegerAccessor(&RoutingProtocol::m_multipathMaxPaths),
+                          MakeUintegerChecker<uint32_t>(1))
+            .AddAttribute("GatewayPrefix",
+                          "Subnet the node answers route requests for as its gateway, with a "
+                          "prefix route, if GatewayPrefixSize is not 0.",
+                          Ipv4AddressValue(Ipv4Address::GetAny()),
+                          MakeIpv4AddressAccessor(&RoutingProtocol::m_gatewayPrefix),
+                          MakeIpv4AddressChecker())
+            .AddAttribute("GatewayPrefixSize",
+                          "Prefix size of GatewayPrefix, or 0 if the node is not a gateway. "
+                          "Packets to the subnet are left to the other routing protocols of the "
+                          "node.",
+                          UintegerValue(0),
+                          MakeUintegerAccessor(&RoutingProtocol::m_gatewayPrefixSize),
+                          MakeUintegerChecker<uint8_t>(0, 31))
+            .AddAttribute("MemoryBudget",
+                          "Memory budget of the routing state in bytes, 0 for none. When the "
+                          "estimate exceeds it, the least recently refreshed routes are dropped, "
+                          "invalid routes first.",
+                          UintegerValue(0),
+                          MakeUintegerAccessor(&RoutingProtocol::m_memoryBudget),
+                          MakeUintegerChecker<uint64_t>())
+            .AddAttribute("MemoryCheckInterval",
+                          "Period of the memory accounting and of the MemoryBudget enforcement. "
+                          "Zero disables both.",
+                          TimeValue(Seconds(0)),
+                          MakeTimeAccessor(&RoutingProtocol::m_memoryCheckInterval),
+                          MakeTimeChecker())
             .AddAttribute("UniformRv",
                           "Access to the underlying UniformRandomVariable",
                           StringValue("ns3::UniformRandomVariable"),
                           MakePointerAccessor(&RoutingProtocol::m_uniformRandomVariable),
-                          MakePointerChecker<UniformRandomVariable>());
+                          MakePointerChecker<UniformRandomVariable>())
+            .AddTraceSource("MemoryUsage",
+                            "Estimated memory of the routing state, in bytes.",
+                            MakeTraceSourceAccessor(&RoutingProtocol::m_memoryUsage),
+                            "ns3::TracedValueCallback::Uint64")
+            .AddTraceSource("RoutingTableMemory",
+                            "Estimated memory of the routing table, in bytes.",
+                            MakeTraceSourceAccessor(&RoutingProtocol::m_routingTableMemory),
+                            "ns3::TracedValueCallback::Uint64")
+            .AddTraceSource("QueueMemory",
+                            "Estimated memory of the packet queue without the packets, in bytes.",
+                            MakeTraceSourceAccessor(&RoutingProtocol::m_queueMemory),
+                            "ns3::TracedValueCallback::Uint64")
+            .AddTraceSource("RreqIdCacheMemory",
+                            "Estimated memory of the RREQ id cache, in bytes.",
+                            MakeTraceSourceAccessor(&RoutingProtocol::m_rreqIdCacheMemory),
+                            "ns3::TracedValueCallback::Uint64")
+            .AddTraceSource("RequestTimerMemory",
+                            "Estimated memory of the route request timers, in bytes.",
+                            MakeTraceSourceAccessor(&RoutingProtocol::m_requestTimerMemory),
+                            "ns3::TracedValueCallback::Uint64")
+            .AddTraceSource("Congestion",
+                            "Congestion estimate of the node, the decayed count of congested "
+                            "RREPs summed over the neighbors.",
+                            MakeTraceSourceAccessor(&RoutingProtocol::m_congestion),
+                            "ns3::TracedValueCallback::Double")
+            .AddTraceSource("NeighborCongestion",
+                            "Congestion estimate of a neighbor after a congested RREP from it.",
+                            MakeTraceSourceAccessor(&RoutingProtocol::m_neighborCongestionTrace),
+                            "ns3::aodv::RoutingProtocol::NeighborCongestionTracedCallback")
+            .AddTraceSource("NeighborCongestionCleared",
+                            "Congestion estimate of a neighbor cleared by a RERR from it.",
+                            MakeTraceSourceAccessor(
+                                &RoutingProtocol::m_neighborCongestionClearedTrace),
+                            "ns3::aodv::RoutingProtocol::NeighborCongestionTracedCallback")
+            .AddTraceSource("RreqCongestionDrop",
+                            "RREQ dropped, or not rebroadcast in gossip mode, because of "
+                            "congestion.",
+                            MakeTraceSourceAccessor(&RoutingProtocol::m_rreqCongestionDropTrace),
+                            "ns3::aodv::RoutingProtocol::RreqTracedCallback");
     return tid;
 }
 
@@ -387,6 +604,12 @@ RoutingProtocol::PrintRoutingTable(Ptr<OutputStreamWrapper> stream, Time::Unit u
     *stream->GetStream() << std::endl;
 }
 
+void
+RoutingProtocol::DumpRoutingTable(Ptr<OutputStreamWrapper> stream) const
+{
+    m_routingTable.Dump(stream, m_ipv4->GetObject<Node>()->GetId());
+}
+
 int64_t
 RoutingProtocol::AssignStreams(int64_t stream)
 {
@@ -408,6 +631,12 @@ RoutingProtocol::Start()
 
     m_rerrRateLimitTimer.SetFunction(&RoutingProtocol::RerrRateLimitTimerExpire, this);
     m_rerrRateLimitTimer.Schedule(Seconds(1));
+
+    if (m_memoryCheckInterval.IsStrictlyPositive())
+    {
+        m_memoryTimer.SetFunction(&RoutingProtocol::MemoryTimerExpire, this);
+        m_memoryTimer.Schedule(m_memoryCheckInterval);
+    }
 }
 
 Ptr<Ipv4Route>
@@ -429,13 +658,19 @@ RoutingProtocol::RouteOutput(Ptr<Packet> p,
         Ptr<Ipv4Route> route;
         return route;
     }
+    Ipv4Address dst = header.GetDestination();
+    if (IsGatewayFor(dst))
+    {
+        NS_LOG_LOGIC("Leave route to " << dst << " in the gateway prefix to other protocols");
+        sockerr = Socket::ERROR_NOROUTETOHOST;
+        return Ptr<Ipv4Route>();
+    }
     sockerr = Socket::ERROR_NOTERROR;
     Ptr<Ipv4Route> route;
-    Ipv4Address dst = header.GetDestination();
-    RoutingTableEntry rt;
-    if (m_routingTable.LookupValidRoute(dst, rt))
+    const RoutingTableEntry* rt = m_routingTable.LookupRoute(dst);
+    if (rt != nullptr && rt->GetFlag() == VALID)
     {
-        route = rt.GetRoute();
+        route = rt->GetRoute();
         NS_ASSERT(route);
         NS_LOG_DEBUG("Exist route to " << route->GetDestination() << " from interface "
                                        << route->GetSource());
@@ -445,8 +680,10 @@ RoutingProtocol::RouteOutput(Ptr<Packet> p,
             sockerr = Socket::ERROR_NOROUTETOHOST;
             return Ptr<Ipv4Route>();
         }
-        UpdateRouteLifeTime(dst, m_activeRouteTimeout);
-        UpdateRouteLifeTime(route->GetGateway(), m_activeRouteTimeout);
+        // Refresh the matched route, which may be a prefix route covering dst
+        m_routingTable.TouchRoutes({rt->GetDestination(), route->GetGateway()},
+                                   m_activeRouteTimeout);
+        CheckRouteCongestion(dst);
         return route;
     }
 
@@ -483,7 +720,14 @@ RoutingProtocol::DeferredRouteOutput(Ptr<const Packet> p,
         if (!result || ((rt.GetFlag() != IN_SEARCH) && result))
         {
             NS_LOG_LOGIC("Send new RREQ for outbound packet to " << header.GetDestination());
-            SendRequest(header.GetDestination());
+            if (m_rreqBatchWindow.IsStrictlyPositive())
+            {
+                BatchRequest(header.GetDestination());
+            }
+            else
+            {
+                SendRequest(header.GetDestination());
+            }
         }
     }
 }
@@ -603,12 +847,12 @@ RoutingProtocol::RouteInput(Ptr<const Packet> p,
     // Unicast local delivery
     if (m_ipv4->IsDestinationAddress(dst, iif))
     {
-        UpdateRouteLifeTime(origin, m_activeRouteTimeout);
-        RoutingTableEntry toOrigin;
-        if (m_routingTable.LookupValidRoute(origin, toOrigin))
+        const RoutingTableEntry* toOrigin = m_routingTable.LookupRoute(origin);
+        if (toOrigin != nullptr && toOrigin->GetFlag() == VALID)
         {
-            UpdateRouteLifeTime(toOrigin.GetNextHop(), m_activeRouteTimeout);
-            m_nb.Update(toOrigin.GetNextHop(), m_activeRouteTimeout);
+            Ipv4Address nextHop = toOrigin->GetNextHop();
+            m_routingTable.TouchRoutes({origin, nextHop}, m_activeRouteTimeout);
+            m_nb.Update(nextHop, m_activeRouteTimeout);
         }
         if (!lcb.IsNull())
         {
@@ -632,6 +876,13 @@ RoutingProtocol::RouteInput(Ptr<const Packet> p,
         return true;
     }
 
+    // The subnet of a gateway is reached through the other routing protocols of the node
+    if (IsGatewayFor(dst))
+    {
+        NS_LOG_LOGIC("Leave packet to " << dst << " in the gateway prefix to other protocols");
+        return false;
+    }
+
     // Forwarding
     return Forwarding(p, header, ucb, ecb);
 }
@@ -645,50 +896,54 @@ RoutingProtocol::Forwarding(Ptr<const Packet> p,
     NS_LOG_FUNCTION(this);
     Ipv4Address dst = header.GetDestination();
     Ipv4Address origin = header.GetSource();
-    m_routingTable.Purge();
-    RoutingTableEntry toDst;
-    if (m_routingTable.LookupRoute(dst, toDst))
-    {
-        if (toDst.GetFlag() == VALID)
-        {
-            Ptr<Ipv4Route> route = toDst.GetRoute();
-            NS_LOG_LOGIC(route->GetSource() << " forwarding to " << dst << " from " << origin
-                                            << " packet " << p->GetUid());
-
-            /*
-             *  Each time a route is used to forward a data packet, its Active Route
-             *  Lifetime field of the source, destination and the next hop on the
-             *  path to the destination is updated to be no less than the current
-             *  time plus ActiveRouteTimeout.
-             */
-            UpdateRouteLifeTime(origin, m_activeRouteTimeout);
-            UpdateRouteLifeTime(dst, m_activeRouteTimeout);
-            UpdateRouteLifeTime(route->GetGateway(), m_activeRouteTimeout);
-            /*
-             *  Since the route between each originator and destination pair is expected to be
-             * symmetric, the Active Route Lifetime for the previous hop, along the reverse path
-             * back to the IP source, is also updated to be no less than the current time plus
-             * ActiveRouteTimeout
-             */
-            RoutingTableEntry toOrigin;
-            m_routingTable.LookupRoute(origin, toOrigin);
-            UpdateRouteLifeTime(toOrigin.GetNextHop(), m_activeRouteTimeout);
-
-            m_nb.Update(route->GetGateway(), m_activeRouteTimeout);
-            m_nb.Update(toOrigin.GetNextHop(), m_activeRouteTimeout);
-
-            ucb(route, p, header);
-            return true;
-        }
-        else
-        {
-            if (toDst.GetValidSeqNo())
+    /*
+     *  Each time a route is used to forward a data packet, its Active Route
+     *  Lifetime field of the source, destination and the next hop on the
+     *  path to the destination is updated to be no less than the current
+     *  time plus ActiveRouteTimeout.
+     *  Since the route between each originator and destination pair is expected to be
+     * symmetric, the Active Route Lifetime for the previous hop, along the reverse path back
+     * to the IP source, is also updated to be no less than the current time plus
+     * ActiveRouteTimeout. All four routes are refreshed in one pass over the table.
+     */
+    Ipv4Address originNextHop;
+    Ptr<Ipv4Route> route = m_routingTable.UseRoute(
+        origin,
+        dst,
+        m_activeRouteTimeout,
+        [this, &p, &header](const RoutingTableEntry& toDst) {
+            uint32_t path = 0;
+            if (toDst.GetPathCount() > 1)
             {
-                SendRerrWhenNoRouteToForward(dst, toDst.GetSeqNo(), origin);
-                NS_LOG_DEBUG("Drop packet " << p->GetUid() << " because no route to forward it.");
-                return false;
+                path = FlowHash(p, header) % toDst.GetPathCount();
+                if (m_helloLoadExtension)
+                {
+                    path = SelectUnloadedPath(toDst, path);
+                }
             }
+            return path;
+        },
+        originNextHop);
+    if (route)
+    {
+        NS_LOG_LOGIC(route->GetSource() << " forwarding to " << dst << " from " << origin
+                                        << " packet " << p->GetUid());
+        m_nb.Update(route->GetGateway(), m_activeRouteTimeout);
+        if (originNextHop != route->GetGateway())
+        {
+            m_nb.Update(originNextHop, m_activeRouteTimeout);
         }
+        CheckRouteCongestion(dst);
+
+        ucb(route, p, header);
+        return true;
+    }
+    const RoutingTableEntry* toDst = m_routingTable.LookupRoute(dst);
+    if (toDst != nullptr && toDst->GetValidSeqNo())
+    {
+        SendRerrWhenNoRouteToForward(dst, toDst->GetSeqNo(), origin);
+        NS_LOG_DEBUG("Drop packet " << p->GetUid() << " because no route to forward it.");
+        return false;
     }
     NS_LOG_LOGIC("route not found to " << dst << ". Send RERR message.");
     NS_LOG_DEBUG("Drop packet " << p->GetUid() << " because no route to forward it.");
@@ -696,6 +951,25 @@ RoutingProtocol::Forwarding(Ptr<const Packet> p,
     return false;
 }
 
+uint32_t
+RoutingProtocol::FlowHash(Ptr<const Packet> p, const Ipv4Header& header)
+{
+    uint32_t hash = header.GetSource().Get() * 2654435761U;
+    hash = (hash ^ header.GetDestination().Get()) * 2654435761U;
+    hash ^= header.GetProtocol();
+    // TCP and UDP start with the source and destination ports
+    uint8_t ports[4];
+    if ((header.GetProtocol() == 6 || header.GetProtocol() == 17) &&
+        header.GetFragmentOffset() == 0 && header.IsLastFragment() && p->GetSize() >= 4)
+    {
+        p->CopyData(ports, 4);
+        hash = (hash ^ ((uint32_t(ports[0]) << 24) | (uint32_t(ports[1]) << 16) |
+                        (uint32_t(ports[2]) << 8) | ports[3])) *
+               2654435761U;
+    }
+    return hash ^ (hash >> 16);
+}
+
 void
 RoutingProtocol::SetIpv4(Ptr<Ipv4> ipv4)
 {
@@ -790,14 +1064,213 @@ RoutingProtocol::NotifyInterfaceUp(uint32_t i)
 
     mac->TraceConnectWithoutContext("DroppedMpdu",
                                     MakeCallback(&RoutingProtocol::NotifyTxError, this));
+    m_macQueues[i] = mac->GetTxopQueue(mac->GetQosSupported() ? AC_BE : AC_BE_NQOS);
 }
 
 void
 RoutingProtocol::NotifyTxError(WifiMacDropReason reason, Ptr<const WifiMpdu> mpdu)
 {
+    m_recentMacDrops = GetRecentMacDrops() + 1;
+    m_lastMacDropTime = Simulator::Now();
     m_nb.GetTxErrorCallback()(mpdu->GetHeader());
 }
 
+double
+RoutingProtocol::GetRecentMacDrops() const
+{
+    double age = (Simulator::Now() - m_lastMacDropTime).GetSeconds();
+    return m_recentMacDrops * std::exp(-age / m_loadDropWindow.GetSeconds());
+}
+
+uint8_t
+RoutingProtocol::GetLoadLevel()
+{
+    double load = double(m_queue.GetSize()) / std::max(m_maxQueueLen, uint32_t(1));
+    for (auto i = m_macQueues.begin(); i != m_macQueues.end(); ++i)
+    {
+        uint32_t maxSize = i->second->GetMaxSize().GetValue();
+        if (maxSize != 0)
+        {
+            load = std::max(load, double(i->second->GetNPackets()) / maxSize);
+        }
+    }
+    load = std::min(std::max(load, GetRecentMacDrops() / m_loadDropThreshold), 1.0);
+    uint8_t level = std::min(uint8_t(load * (MAX_LOAD_LEVEL + 1)), uint8_t(MAX_LOAD_LEVEL));
+    NS_LOG_LOGIC("Load " << load << ", level " << uint32_t(level));
+    return level;
+}
+
+void
+RoutingProtocol::AddNeighborCongestion(Ipv4Address neighbor)
+{
+    CongestionEstimate& estimate = m_neighborCongestion[neighbor];
+    estimate.value = GetNeighborCongestion(neighbor) + 1;
+    estimate.lastUpdate = Simulator::Now();
+    NS_LOG_LOGIC("Congestion of neighbor " << neighbor << " " << estimate.value);
+    m_neighborCongestionTrace(neighbor, estimate.value);
+    UpdateCongestion();
+}
+
+double
+RoutingProtocol::GetNeighborCongestion(Ipv4Address neighbor) const
+{
+    auto i = m_neighborCongestion.find(neighbor);
+    if (i == m_neighborCongestion.end())
+    {
+        return 0;
+    }
+    double age = (Simulator::Now() - i->second.lastUpdate).GetSeconds();
+    return i->second.value * std::exp(-age / m_congestionDecayTime.GetSeconds());
+}
+
+double
+RoutingProtocol::GetCongestion() const
+{
+    double congestion = 0;
+    for (auto i = m_neighborCongestion.begin(); i != m_neighborCongestion.end(); ++i)
+    {
+        congestion += GetNeighborCongestion(i->first);
+    }
+    return congestion;
+}
+
+void
+RoutingProtocol::UpdateCongestion()
+{
+    for (auto i = m_neighborCongestion.begin(); i != m_neighborCongestion.end();)
+    {
+        if (GetNeighborCongestion(i->first) < MIN_NEIGHBOR_CONGESTION)
+        {
+            i = m_neighborCongestion.erase(i);
+            continue;
+        }
+        ++i;
+    }
+    m_congestion = GetCongestion();
+    // Keep the trace following the decay until the last estimate is forgotten
+    if (!m_neighborCongestion.empty() && !m_congestionTimer.IsRunning())
+    {
+        m_congestionTimer.SetFunction(&RoutingProtocol::UpdateCongestion, this);
+        m_congestionTimer.Schedule(m_congestionUpdateInterval);
+    }
+}
+
+double
+RoutingProtocol::GetRreqForwardingProbability()
+{
+    double congestion = GetCongestion();
+    if (congestion <= m_gossipOnset)
+    {
+        return 1;
+    }
+    if (congestion >= m_congestionThreshold)
+    {
+        return m_gossipMinProbability;
+    }
+    double fraction = (congestion - m_gossipOnset) / (m_congestionThreshold - m_gossipOnset);
+    return 1 - (1 - m_gossipMinProbability) * fraction;
+}
+
+double
+RoutingProtocol::GetReplyMetric(uint16_t hops, int32_t loadLevel, Ipv4Address neighbor) const
+{
+    return hops + m_replyLoadWeight * loadLevel +
+           m_replyNeighborWeight * GetNeighborCongestion(neighbor);
+}
+
+uint8_t
+RoutingProtocol::GetNeighborLoadLevel(Ipv4Address neighbor) const
+{
+    auto i = m_neighborLoad.find(neighbor);
+    if (i == m_neighborLoad.end() ||
+        Simulator::Now() - i->second.lastUpdate > Time(m_allowedHelloLoss * m_helloInterval))
+    {
+        return 0;
+    }
+    return i->second.loadLevel;
+}
+
+bool
+RoutingProtocol::IsNeighborhoodCongested(Ipv4Address src)
+{
+    Time maxAge = Time(m_allowedHelloLoss * m_helloInterval);
+    bool known = false;
+    for (auto i = m_neighborLoad.begin(); i != m_neighborLoad.end();)
+    {
+        if (Simulator::Now() - i->second.lastUpdate > maxAge)
+        {
+            i = m_neighborLoad.erase(i);
+            continue;
+        }
+        if (i->first != src)
+        {
+            if (i->second.loadLevel < m_congestedLoadLevel)
+            {
+                return false;
+            }
+            known = true;
+        }
+        ++i;
+    }
+    return known;
+}
+
+uint32_t
+RoutingProtocol::SelectUnloadedPath(const RoutingTableEntry& rt, uint32_t path) const
+{
+    uint8_t best = GetNeighborLoadLevel(rt.GetRoute(path)->GetGateway());
+    if (best < m_congestedLoadLevel)
+    {
+        return path;
+    }
+    for (uint32_t i = 0; i < rt.GetPathCount() && best > 0; ++i)
+    {
+        uint8_t level = GetNeighborLoadLevel(rt.GetRoute(i)->GetGateway());
+        if (level < best)
+        {
+            best = level;
+            path = i;
+        }
+    }
+    return path;
+}
+
+void
+RoutingProtocol::CountDuplicateRequest(Ipv4Address origin, uint32_t id)
+{
+    auto i = m_pendingRebroadcasts.find(std::make_pair(origin, id));
+    if (i == m_pendingRebroadcasts.end() || ++i->second.copies < m_rreqSuppressionCount)
+    {
+        return;
+    }
+    NS_LOG_DEBUG("Cancel rebroadcast of RREQ " << id << " from " << origin << " after "
+                                               << i->second.copies << " copies");
+    for (auto& send : i->second.sends)
+    {
+        send.Cancel();
+    }
+    m_pendingRebroadcasts.erase(i);
+}
+
+void
+RoutingProtocol::PurgePendingRebroadcasts()
+{
+    for (auto i = m_pendingRebroadcasts.begin(); i != m_pendingRebroadcasts.end();)
+    {
+        const std::vector<EventId>& sends = i->second.sends;
+        if (std::none_of(sends.begin(), sends.end(), [](const EventId& send) {
+                return send.IsPending();
+            }))
+        {
+            i = m_pendingRebroadcasts.erase(i);
+        }
+        else
+        {
+            ++i;
+        }
+    }
+}
+
 void
 RoutingProtocol::NotifyInterfaceDown(uint32_t i)
 {
@@ -814,6 +1287,7 @@ RoutingProtocol::NotifyInterfaceDown(uint32_t i)
         {
             mac->TraceDisconnectWithoutContext("DroppedMpdu",
                                                MakeCallback(&RoutingProtocol::NotifyTxError, this));
+            m_macQueues.erase(i);
             m_nb.DelArpCache(l3->GetInterface(i)->GetArpCache());
         }
     }
@@ -988,6 +1462,17 @@ RoutingProtocol::IsMyOwnAddress(Ipv4Address src)
     return false;
 }
 
+bool
+RoutingProtocol::IsGatewayFor(Ipv4Address dst) const
+{
+    if (m_gatewayPrefixSize == 0)
+    {
+        return false;
+    }
+    Ipv4Mask mask(~uint32_t(0) << (32 - m_gatewayPrefixSize));
+    return dst.CombineMask(mask) == m_gatewayPrefix.CombineMask(mask);
+}
+
 Ptr<Ipv4Route>
 RoutingProtocol::LoopbackRoute(const Ipv4Header& hdr, Ptr<NetDevice> oif) const
 {
@@ -1056,12 +1541,17 @@ RoutingProtocol::SendRequest(Ipv4Address dst)
     // Create RREQ header
     RreqHeader rreqHeader;
     rreqHeader.SetDst(dst);
+    uint16_t ttl = StartSearch(dst, rreqHeader);
+    BroadcastRequest(rreqHeader, ttl);
+    ScheduleRreqRetry(dst);
+}
 
-    RoutingTableEntry rt;
+uint16_t
+RoutingProtocol::StartSearch(Ipv4Address dst, RreqHeader& rreqHeader)
+{
     // Using the Hop field in Routing Table to manage the expanding ring search
     uint16_t ttl = m_ttlStart;
-    if (m_routingTable.LookupRoute(dst, rt))
-    {
+    auto startSearch = [this, &ttl, &rreqHeader](RoutingTableEntry& rt) {
         if (rt.GetFlag() != IN_SEARCH)
         {
             ttl = std::min<uint16_t>(rt.GetHop() + m_ttlIncrement, m_netDiameter);
@@ -1089,9 +1579,8 @@ RoutingProtocol::SendRequest(Ipv4Address dst)
         rt.SetHop(ttl);
         rt.SetFlag(IN_SEARCH);
         rt.SetLifeTime(m_pathDiscoveryTime);
-        m_routingTable.Update(rt);
-    }
-    else
+    };
+    if (!m_routingTable.ModifyRoute(dst, startSearch))
     {
         rreqHeader.SetUnknownSeqno(true);
         Ptr<NetDevice> dev = nullptr;
@@ -1111,7 +1600,110 @@ RoutingProtocol::SendRequest(Ipv4Address dst)
         newEntry.SetFlag(IN_SEARCH);
         m_routingTable.AddRoute(newEntry);
     }
+    return ttl;
+}
+
+void
+RoutingProtocol::BatchRequest(Ipv4Address dst)
+{
+    NS_LOG_FUNCTION(this << dst);
+    if (std::find(m_batchedDestinations.begin(), m_batchedDestinations.end(), dst) ==
+        m_batchedDestinations.end())
+    {
+        m_batchedDestinations.push_back(dst);
+    }
+    if (!m_rreqBatchTimer.IsRunning())
+    {
+        m_rreqBatchTimer.SetFunction(&RoutingProtocol::SendBatchedRequest, this);
+        m_rreqBatchTimer.Schedule(m_rreqBatchWindow);
+    }
+}
+
+void
+RoutingProtocol::SendBatchedRequest()
+{
+    NS_LOG_FUNCTION(this << m_batchedDestinations.size());
+    // Destinations reached meanwhile, e.g. by the reverse route of an RREQ from them, need no
+    // discovery
+    for (auto i = m_batchedDestinations.begin(); i != m_batchedDestinations.end();)
+    {
+        RoutingTableEntry rt;
+        if (m_routingTable.LookupRoute(*i, rt) && rt.GetFlag() == VALID)
+        {
+            SendPacketFromQueue(*i, rt.GetRoute());
+            i = m_batchedDestinations.erase(i);
+        }
+        else
+        {
+            ++i;
+        }
+    }
+
+    while (!m_batchedDestinations.empty())
+    {
+        if (m_rreqCount == m_rreqRateLimit)
+        {
+            m_rreqBatchTimer.Schedule(m_rreqRateLimitTimer.GetDelayLeft() + MicroSeconds(100));
+            return;
+        }
+        m_rreqCount++;
+
+        auto batchSize = std::min<std::size_t>(m_batchedDestinations.size(),
+                                               1 + DestinationsExtensionHeader::MAX_DESTINATIONS);
+        auto batchEnd = m_batchedDestinations.begin() + batchSize;
+        // The first destination goes in the RREQ itself, so that nodes without the extension
+        // still handle the RREQ for it
+        RreqHeader rreqHeader;
+        rreqHeader.SetDst(m_batchedDestinations.front());
+        uint16_t ttl = StartSearch(m_batchedDestinations.front(), rreqHeader);
+        DestinationsExtensionHeader destinations;
+        for (auto i = m_batchedDestinations.begin() + 1; i != batchEnd; ++i)
+        {
+            RreqHeader search;
+            ttl = std::max(ttl, StartSearch(*i, search));
+            destinations.AddDestination(*i, search.GetDstSeqno(), search.GetUnknownSeqno());
+        }
+        NS_LOG_DEBUG("Send RREQ for " << batchSize << " destinations");
+        BroadcastRequest(rreqHeader, ttl, destinations);
+        // Retries are per destination
+        for (auto i = m_batchedDestinations.begin(); i != batchEnd; ++i)
+        {
+            ScheduleRreqRetry(*i);
+        }
+        m_batchedDestinations.erase(m_batchedDestinations.begin(), batchEnd);
+    }
+}
+
+void
+RoutingProtocol::SendProactiveRequest(Ipv4Address dst)
+{
+    NS_LOG_FUNCTION(this << dst);
+    RoutingTableEntry rt;
+    if (!m_routingTable.LookupRoute(dst, rt) || rt.GetFlag() != VALID || !rt.GetValidSeqNo())
+    {
+        return;
+    }
+    // The route is still usable, so the request is not retried at the rate limit
+    if (m_rreqCount == m_rreqRateLimit)
+    {
+        NS_LOG_DEBUG("RREQ rate limit reached, no proactive discovery of " << dst);
+        return;
+    }
+    m_rreqCount++;
 
+    RreqHeader rreqHeader;
+    rreqHeader.SetDst(dst);
+    // Only the destination and nodes with a fresher route reply, and the replies are newer than
+    // the route in use
+    rreqHeader.SetDstSeqno(rt.GetSeqNo() + 1);
+    BroadcastRequest(rreqHeader, std::min<uint16_t>(rt.GetHop() + m_ttlIncrement, m_netDiameter));
+}
+
+void
+RoutingProtocol::BroadcastRequest(RreqHeader& rreqHeader,
+                                  uint16_t ttl,
+                                  const DestinationsExtensionHeader& destinations)
+{
     if (m_gratuitousReply)
     {
         rreqHeader.SetGratuitousRrep(true);
@@ -1139,6 +1731,10 @@ RoutingProtocol::SendRequest(Ipv4Address dst)
         SocketIpTtlTag tag;
         tag.SetTtl(ttl);
         packet->AddPacketTag(tag);
+        if (!destinations.GetDestinations().empty())
+        {
+            packet->AddHeader(destinations);
+        }
         packet->AddHeader(rreqHeader);
         TypeHeader tHeader(AODVTYPE_RREQ);
         packet->AddHeader(tHeader);
@@ -1161,7 +1757,26 @@ RoutingProtocol::SendRequest(Ipv4Address dst)
                             packet,
                             destination);
     }
-    ScheduleRreqRetry(dst);
+}
+
+void
+RoutingProtocol::CheckRouteCongestion(Ipv4Address dst)
+{
+    if (m_rediscoveryLoadLevel == 0)
+    {
+        return;
+    }
+    const RoutingTableEntry* rt = m_routingTable.LookupRoute(dst);
+    if (rt == nullptr || rt->GetFlag() != VALID || rt->GetPrefixSize() != 0 ||
+        rt->GetCongestionFlag() < m_rediscoveryLoadLevel ||
+        Simulator::Now() - rt->GetCongestionTime() > m_activeRouteTimeout)
+    {
+        return;
+    }
+    NS_LOG_DEBUG("Route to " << dst << " reported at load level " << rt->GetCongestionFlag()
+                             << ", rediscover it");
+    m_routingTable.ModifyRoute(dst, [](RoutingTableEntry& entry) { entry.SetCongestionFlag(0); });
+    SendProactiveRequest(dst);
 }
 
 void
@@ -1260,19 +1875,20 @@ bool
 RoutingProtocol::UpdateRouteLifeTime(Ipv4Address addr, Time lifetime)
 {
     NS_LOG_FUNCTION(this << addr << lifetime);
-    RoutingTableEntry rt;
-    if (m_routingTable.LookupRoute(addr, rt))
-    {
+    bool valid = false;
+    m_routingTable.ModifyRoute(addr, [lifetime, &valid](RoutingTableEntry& rt) {
         if (rt.GetFlag() == VALID)
         {
-            NS_LOG_DEBUG("Updating VALID route");
             rt.SetRreqCnt(0);
             rt.SetLifeTime(std::max(lifetime, rt.GetLifeTime()));
-            m_routingTable.Update(rt);
-            return true;
+            valid = true;
         }
+    });
+    if (valid)
+    {
+        NS_LOG_DEBUG("Updated VALID route");
     }
-    return false;
+    return valid;
 }
 
 void
@@ -1324,6 +1940,12 @@ RoutingProtocol::RecvRequest(Ptr<Packet> p, Ipv4Address receiver, Ipv4Address sr
     NS_LOG_FUNCTION(this);
     RreqHeader rreqHeader;
     p->RemoveHeader(rreqHeader);
+    // Further destinations of a batched RREQ
+    DestinationsExtensionHeader destinations;
+    if (p->GetSize() >= 2)
+    {
+        p->PeekHeader(destinations);
+    }
 
     // A node ignores all RREQs received from any node in its blacklist
     RoutingTableEntry toPrev;
@@ -1347,13 +1969,17 @@ RoutingProtocol::RecvRequest(Ptr<Packet> p, Ipv4Address receiver, Ipv4Address sr
     if (m_rreqIdCache.IsDuplicate(origin, id))
     {
         NS_LOG_DEBUG("Ignoring RREQ due to duplicate");
+        if (m_rreqSuppressionCount > 0)
+        {
+            CountDuplicateRequest(origin, id);
+        }
         return;
     }
 
-
-    if(m_congestion_count > MAX_CONGESTION_COUNT)
+    if (!m_gossipForwarding && GetCongestion() > m_congestionThreshold)
     {
         NS_LOG_DEBUG("Ignoring RREQ due to maximum congestion");
+        m_rreqCongestionDropTrace(rreqHeader);
         return;
     }
 
@@ -1372,135 +1998,159 @@ RoutingProtocol::RecvRequest(Ptr<Packet> p, Ipv4Address receiver, Ipv4Address sr
      *  5. the Lifetime is set to be the maximum of (ExistingLifetime, MinimalLifetime), where
      *     MinimalLifetime = current time + 2*NetTraversalTime - 2*HopCount*NodeTraversalTime
      */
-    RoutingTableEntry toOrigin;
-    if (!m_routingTable.LookupRoute(origin, toOrigin))
+    Ptr<NetDevice> receiverDev = m_ipv4->GetNetDevice(m_ipv4->GetInterfaceForAddress(receiver));
+    Ipv4InterfaceAddress receiverIface =
+        m_ipv4->GetAddress(m_ipv4->GetInterfaceForAddress(receiver), 0);
+    Time reverseLifetime = Time(2 * m_netTraversalTime - 2 * hop * m_nodeTraversalTime);
+    uint32_t originSeqNo = rreqHeader.GetOriginSeqno();
+    if (!m_routingTable.ModifyRoute(origin, [&](RoutingTableEntry& toOrigin) {
+            if (toOrigin.GetValidSeqNo())
+            {
+                if (int32_t(originSeqNo) - int32_t(toOrigin.GetSeqNo()) > 0)
+                {
+                    toOrigin.SetSeqNo(originSeqNo);
+                }
+            }
+            else
+            {
+                toOrigin.SetSeqNo(originSeqNo);
+            }
+            toOrigin.SetValidSeqNo(true);
+            toOrigin.SetNextHop(src);
+            toOrigin.SetOutputDevice(receiverDev);
+            toOrigin.SetInterface(receiverIface);
+            toOrigin.SetHop(hop);
+            toOrigin.SetLifeTime(std::max(reverseLifetime, toOrigin.GetLifeTime()));
+            // m_nb.Update (src, Time (AllowedHelloLoss * HelloInterval));
+        }))
     {
-        Ptr<NetDevice> dev = m_ipv4->GetNetDevice(m_ipv4->GetInterfaceForAddress(receiver));
         RoutingTableEntry newEntry(
-            /*dev=*/dev,
+            /*dev=*/receiverDev,
             /*dst=*/origin,
             /*vSeqNo=*/true,
-            /*seqNo=*/rreqHeader.GetOriginSeqno(),
-            /*iface=*/m_ipv4->GetAddress(m_ipv4->GetInterfaceForAddress(receiver), 0),
+            /*seqNo=*/originSeqNo,
+            /*iface=*/receiverIface,
             /*hops=*/hop,
             /*nextHop=*/src,
-            /*lifetime=*/Time(2 * m_netTraversalTime - 2 * hop * m_nodeTraversalTime));
+            /*lifetime=*/reverseLifetime);
         m_routingTable.AddRoute(newEntry);
     }
-    else
-    {
-        if (toOrigin.GetValidSeqNo())
-        {
-            if (int32_t(rreqHeader.GetOriginSeqno()) - int32_t(toOrigin.GetSeqNo()) > 0)
-            {
-                toOrigin.SetSeqNo(rreqHeader.GetOriginSeqno());
-            }
-        }
-        else
-        {
-            toOrigin.SetSeqNo(rreqHeader.GetOriginSeqno());
-        }
-        toOrigin.SetValidSeqNo(true);
-        toOrigin.SetNextHop(src);
-        toOrigin.SetOutputDevice(m_ipv4->GetNetDevice(m_ipv4->GetInterfaceForAddress(receiver)));
-        toOrigin.SetInterface(m_ipv4->GetAddress(m_ipv4->GetInterfaceForAddress(receiver), 0));
-        toOrigin.SetHop(hop);
-        toOrigin.SetLifeTime(std::max(Time(2 * m_netTraversalTime - 2 * hop * m_nodeTraversalTime),
-                                      toOrigin.GetLifeTime()));
-        m_routingTable.Update(toOrigin);
-        // m_nb.Update (src, Time (AllowedHelloLoss * HelloInterval));
-    }
 
-    RoutingTableEntry toNeighbor;
-    if (!m_routingTable.LookupRoute(src, toNeighbor))
+    if (!m_routingTable.ModifyRoute(src, [&](RoutingTableEntry& toNeighbor) {
+            toNeighbor.SetLifeTime(m_activeRouteTimeout);
+            toNeighbor.SetValidSeqNo(false);
+            toNeighbor.SetSeqNo(originSeqNo);
+            toNeighbor.SetFlag(VALID);
+            toNeighbor.SetOutputDevice(receiverDev);
+            toNeighbor.SetInterface(receiverIface);
+            toNeighbor.SetHop(1);
+            toNeighbor.SetNextHop(src);
+        }))
     {
         NS_LOG_DEBUG("Neighbor:" << src << " not found in routing table. Creating an entry");
-        Ptr<NetDevice> dev = m_ipv4->GetNetDevice(m_ipv4->GetInterfaceForAddress(receiver));
-        RoutingTableEntry newEntry(dev,
+        RoutingTableEntry newEntry(receiverDev,
                                    src,
                                    false,
-                                   rreqHeader.GetOriginSeqno(),
-                                   m_ipv4->GetAddress(m_ipv4->GetInterfaceForAddress(receiver), 0),
+                                   originSeqNo,
+                                   receiverIface,
                                    1,
                                    src,
                                    m_activeRouteTimeout);
         m_routingTable.AddRoute(newEntry);
     }
-    else
-    {
-        toNeighbor.SetLifeTime(m_activeRouteTimeout);
-        toNeighbor.SetValidSeqNo(false);
-        toNeighbor.SetSeqNo(rreqHeader.GetOriginSeqno());
-        toNeighbor.SetFlag(VALID);
-        toNeighbor.SetOutputDevice(m_ipv4->GetNetDevice(m_ipv4->GetInterfaceForAddress(receiver)));
-        toNeighbor.SetInterface(m_ipv4->GetAddress(m_ipv4->GetInterfaceForAddress(receiver), 0));
-        toNeighbor.SetHop(1);
-        toNeighbor.SetNextHop(src);
-        m_routingTable.Update(toNeighbor);
-    }
     m_nb.Update(src, Time(m_allowedHelloLoss * m_helloInterval));
 
     NS_LOG_LOGIC(receiver << " receive RREQ with hop count "
                           << static_cast<uint32_t>(rreqHeader.GetHopCount()) << " ID "
                           << rreqHeader.GetId() << " to destination " << rreqHeader.GetDst());
 
-    //  A node generates a RREP if either:
-    //  (i)  it is itself the destination,
-    if (IsMyOwnAddress(rreqHeader.GetDst()))
-    {
-        m_routingTable.LookupRoute(origin, toOrigin);
-        NS_LOG_DEBUG("Send reply since I am the destination");
-        SendReply(rreqHeader, toOrigin);
-        return;
+    // The destinations of the extension of a batched RREQ are answered like the one of the RREQ,
+    // and the RREQ is rebroadcast for the others only
+    bool answered = AnswerRequest(rreqHeader, src);
+    DestinationsExtensionHeader unanswered;
+    for (const auto& destination : destinations.GetDestinations())
+    {
+        RreqHeader request = rreqHeader;
+        request.SetDst(destination.dst);
+        request.SetDstSeqno(destination.seqNo);
+        request.SetUnknownSeqno(destination.unknownSeqno);
+        if (!AnswerRequest(request, src))
+        {
+            unanswered.AddDestination(destination.dst,
+                                      request.GetDstSeqno(),
+                                      request.GetUnknownSeqno());
+        }
     }
-    /*
-     * (ii) or it has an active route to the destination, the destination sequence number in the
-     * node's existing route table entry for the destination is valid and greater than or equal to
-     * the Destination Sequence Number of the RREQ, and the "destination only" flag is NOT set.
-     */
-    RoutingTableEntry toDst;
-    Ipv4Address dst = rreqHeader.GetDst();
-    if (m_routingTable.LookupRoute(dst, toDst))
+    if (answered)
     {
-        /*
-         * Drop RREQ, This node RREP will make a loop.
-         */
-        if (toDst.GetNextHop() == src)
+        if (unanswered.GetDestinations().empty())
         {
-            NS_LOG_DEBUG("Drop RREQ from " << src << ", dest next hop " << toDst.GetNextHop());
             return;
         }
-        /*
-         * The Destination Sequence number for the requested destination is set to the maximum of
-         * the corresponding value received in the RREQ message, and the destination sequence value
-         * currently maintained by the node for the requested destination. However, the forwarding
-         * node MUST NOT modify its maintained value for the destination sequence number, even if
-         * the value received in the incoming RREQ is larger than the value currently maintained by
-         * the forwarding node.
-         */
-        if ((rreqHeader.GetUnknownSeqno() ||
-             (int32_t(toDst.GetSeqNo()) - int32_t(rreqHeader.GetDstSeqno()) >= 0)) &&
-            toDst.GetValidSeqNo())
+        // Nodes without the extension only see the destination of the RREQ itself
+        DestinationsExtensionHeader others;
+        for (auto j = unanswered.GetDestinations().begin(); j != unanswered.GetDestinations().end();
+             ++j)
         {
-            if (!rreqHeader.GetDestinationOnly() && toDst.GetFlag() == VALID)
+            if (j == unanswered.GetDestinations().begin())
             {
-                m_routingTable.LookupRoute(origin, toOrigin);
-                SendReplyByIntermediateNode(toDst, toOrigin, rreqHeader.GetGratuitousRrep());
-                return;
+                rreqHeader.SetDst(j->dst);
+                rreqHeader.SetDstSeqno(j->seqNo);
+                rreqHeader.SetUnknownSeqno(j->unknownSeqno);
+            }
+            else
+            {
+                others.AddDestination(j->dst, j->seqNo, j->unknownSeqno);
             }
-            rreqHeader.SetDstSeqno(toDst.GetSeqNo());
-            rreqHeader.SetUnknownSeqno(false);
         }
+        unanswered = others;
     }
 
     SocketIpTtlTag tag;
     p->RemovePacketTag(tag);
     if (tag.GetTtl() < 2)
     {
-        NS_LOG_DEBUG("TTL exceeded. Drop RREQ origin " << src << " destination " << dst);
+        NS_LOG_DEBUG("TTL exceeded. Drop RREQ origin " << src << " destination "
+                                                        << rreqHeader.GetDst());
         return;
     }
 
+    if (m_gossipForwarding)
+    {
+        double probability = GetRreqForwardingProbability();
+        if (m_uniformRandomVariable->GetValue(0, 1) >= probability)
+        {
+            NS_LOG_DEBUG("Not rebroadcasting RREQ under congestion, probability " << probability);
+            m_rreqCongestionDropTrace(rreqHeader);
+            return;
+        }
+    }
+
+    // A requested destination that is a neighbor is reached without crossing the congestion.
+    // With batching, that holds for the destinations carried in the extension as well.
+    auto isNeighbor = [this](Ipv4Address dst) {
+        return m_neighborLoad.find(dst) != m_neighborLoad.end();
+    };
+    if (m_helloLoadExtension && IsNeighborhoodCongested(src) && !isNeighbor(rreqHeader.GetDst()) &&
+        std::none_of(unanswered.GetDestinations().begin(),
+                     unanswered.GetDestinations().end(),
+                     [&isNeighbor](const DestinationsExtensionHeader::Destination& destination) {
+                         return isNeighbor(destination.dst);
+                     }))
+    {
+        NS_LOG_DEBUG("Not rebroadcasting RREQ, all neighbors are congested");
+        m_rreqCongestionDropTrace(rreqHeader);
+        return;
+    }
+
+    // With counter-based suppression the rebroadcasts are kept, to cancel them on duplicates
+    PendingRebroadcast* pending = nullptr;
+    if (m_rreqSuppressionCount > 0)
+    {
+        PurgePendingRebroadcasts();
+        pending = &m_pendingRebroadcasts[std::make_pair(origin, id)];
+        pending->copies = 1;
+    }
     for (auto j = m_socketAddresses.begin(); j != m_socketAddresses.end(); ++j)
     {
         Ptr<Socket> socket = j->first;
@@ -1509,6 +2159,10 @@ RoutingProtocol::RecvRequest(Ptr<Packet> p, Ipv4Address receiver, Ipv4Address sr
         SocketIpTtlTag ttl;
         ttl.SetTtl(tag.GetTtl() - 1);
         packet->AddPacketTag(ttl);
+        if (!unanswered.GetDestinations().empty())
+        {
+            packet->AddHeader(unanswered);
+        }
         packet->AddHeader(rreqHeader);
         TypeHeader tHeader(AODVTYPE_RREQ);
         packet->AddHeader(tHeader);
@@ -1523,15 +2177,87 @@ RoutingProtocol::RecvRequest(Ptr<Packet> p, Ipv4Address receiver, Ipv4Address sr
             destination = iface.GetBroadcast();
         }
         m_lastBcastTime = Simulator::Now();
-        Simulator::Schedule(Time(MilliSeconds(m_uniformRandomVariable->GetInteger(0, 10))),
-                            &RoutingProtocol::SendTo,
-                            this,
-                            socket,
-                            packet,
-                            destination);
+        EventId send =
+            Simulator::Schedule(Time(MilliSeconds(m_uniformRandomVariable->GetInteger(0, 10))),
+                                &RoutingProtocol::SendTo,
+                                this,
+                                socket,
+                                packet,
+                                destination);
+        if (pending != nullptr)
+        {
+            pending->sends.push_back(send);
+        }
     }
 }
 
+bool
+RoutingProtocol::AnswerRequest(RreqHeader& rreqHeader, Ipv4Address src)
+{
+    NS_LOG_FUNCTION(this << rreqHeader.GetDst() << src);
+    Ipv4Address origin = rreqHeader.GetOrigin();
+
+    //  A node generates a RREP if either:
+    //  (i)  it is itself the destination, or the gateway of its subnet,
+    RoutingTableEntry toOrigin;
+    if (IsMyOwnAddress(rreqHeader.GetDst()) || IsGatewayFor(rreqHeader.GetDst()))
+    {
+        m_routingTable.LookupRoute(origin, toOrigin);
+        NS_LOG_DEBUG("Send reply since I am the destination or its gateway");
+        SendReply(rreqHeader, toOrigin);
+        return true;
+    }
+    /*
+     * (ii) or it has an active route to the destination, the destination sequence number in the
+     * node's existing route table entry for the destination is valid and greater than or equal to
+     * the Destination Sequence Number of the RREQ, and the "destination only" flag is NOT set.
+     * The route may be a prefix route to the subnet of the destination.
+     */
+    RoutingTableEntry toDst;
+    Ipv4Address dst = rreqHeader.GetDst();
+    const RoutingTableEntry* route = m_routingTable.LookupRoute(dst);
+    if (route != nullptr)
+    {
+        toDst = *route;
+        /*
+         * Drop RREQ, This node RREP will make a loop.
+         */
+        if (toDst.GetNextHop() == src)
+        {
+            NS_LOG_DEBUG("Drop RREQ from " << src << ", dest next hop " << toDst.GetNextHop());
+            return true;
+        }
+        /*
+         * The Destination Sequence number for the requested destination is set to the maximum of
+         * the corresponding value received in the RREQ message, and the destination sequence value
+         * currently maintained by the node for the requested destination. However, the forwarding
+         * node MUST NOT modify its maintained value for the destination sequence number, even if
+         * the value received in the incoming RREQ is larger than the value currently maintained by
+         * the forwarding node.
+         */
+        if ((rreqHeader.GetUnknownSeqno() ||
+             (int32_t(toDst.GetSeqNo()) - int32_t(rreqHeader.GetDstSeqno()) >= 0)) &&
+            toDst.GetValidSeqNo())
+        {
+            if (!rreqHeader.GetDestinationOnly() && toDst.GetFlag() == VALID &&
+                (m_gossipForwarding ||
+                 GetNeighborCongestion(toDst.GetNextHop()) <= m_congestionThreshold))
+            {
+                m_routingTable.LookupRoute(origin, toOrigin);
+                SendReplyByIntermediateNode(dst,
+                                            toDst,
+                                            toOrigin,
+                                            rreqHeader.GetGratuitousRrep());
+                return true;
+            }
+            rreqHeader.SetDstSeqno(toDst.GetSeqNo());
+            rreqHeader.SetUnknownSeqno(false);
+        }
+    }
+
+    return false;
+}
+
 void
 RoutingProtocol::SendReply(const RreqHeader& rreqHeader, const RoutingTableEntry& toOrigin)
 {
@@ -1545,12 +2271,15 @@ RoutingProtocol::SendReply(const RreqHeader& rreqHeader, const RoutingTableEntry
     {
         m_seqNo++;
     }
-    RrepHeader rrepHeader(/*prefixSize=*/0,
+    // A gateway answers for its whole subnet
+    uint8_t prefixSize = IsMyOwnAddress(rreqHeader.GetDst()) ? 0 : m_gatewayPrefixSize;
+    RrepHeader rrepHeader(/*prefixSize=*/prefixSize,
                           /*hopCount=*/0,
                           /*dst=*/rreqHeader.GetDst(),
                           /*dstSeqNo=*/m_seqNo,
                           /*origin=*/toOrigin.GetDestination(),
-                          /*lifetime=*/m_myRouteTimeout,1);
+                          /*lifetime=*/m_myRouteTimeout,
+                          /*congestion_flag=*/GetLoadLevel());
     Ptr<Packet> packet = Create<Packet>();
     SocketIpTtlTag tag;
     tag.SetTtl(toOrigin.GetHop());
@@ -1564,17 +2293,19 @@ RoutingProtocol::SendReply(const RreqHeader& rreqHeader, const RoutingTableEntry
 }
 
 void
-RoutingProtocol::SendReplyByIntermediateNode(RoutingTableEntry& toDst,
+RoutingProtocol::SendReplyByIntermediateNode(Ipv4Address dst,
+                                             RoutingTableEntry& toDst,
                                              RoutingTableEntry& toOrigin,
                                              bool gratRep)
 {
-    NS_LOG_FUNCTION(this);
-    RrepHeader rrepHeader(/*prefixSize=*/0,
+    NS_LOG_FUNCTION(this << dst);
+    RrepHeader rrepHeader(/*prefixSize=*/toDst.GetPrefixSize(),
                           /*hopCount=*/toDst.GetHop(),
-                          /*dst=*/toDst.GetDestination(),
+                          /*dst=*/dst,
                           /*dstSeqNo=*/toDst.GetSeqNo(),
                           /*origin=*/toOrigin.GetDestination(),
-                          /*lifetime=*/toDst.GetLifeTime());
+                          /*lifetime=*/toDst.GetLifeTime(),
+                          /*congestion_flag=*/GetLoadLevel());
     /* If the node we received a RREQ for is a neighbor we are
      * probably facing a unidirectional link... Better request a RREP-ack
      */
@@ -1589,8 +2320,14 @@ RoutingProtocol::SendReplyByIntermediateNode(RoutingTableEntry& toDst,
     }
     toDst.InsertPrecursor(toOrigin.GetNextHop());
     toOrigin.InsertPrecursor(toDst.GetNextHop());
-    m_routingTable.Update(toDst);
-    m_routingTable.Update(toOrigin);
+    Ipv4Address originNextHop = toOrigin.GetNextHop();
+    Ipv4Address dstNextHop = toDst.GetNextHop();
+    m_routingTable.ModifyRoute(toDst.GetDestination(), [originNextHop](RoutingTableEntry& rt) {
+        rt.InsertPrecursor(originNextHop);
+    });
+    m_routingTable.ModifyRoute(toOrigin.GetDestination(), [dstNextHop](RoutingTableEntry& rt) {
+        rt.InsertPrecursor(dstNextHop);
+    });
 
     Ptr<Packet> packet = Create<Packet>();
     SocketIpTtlTag tag;
@@ -1610,8 +2347,9 @@ RoutingProtocol::SendReplyByIntermediateNode(RoutingTableEntry& toDst,
                                  /*hopCount=*/toOrigin.GetHop(),
                                  /*dst=*/toOrigin.GetDestination(),
                                  /*dstSeqNo=*/toOrigin.GetSeqNo(),
-                                 /*origin=*/toDst.GetDestination(),
-                                 /*lifetime=*/toOrigin.GetLifeTime());
+                                 /*origin=*/dst,
+                                 /*lifetime=*/toOrigin.GetLifeTime(),
+                                 /*congestion_flag=*/GetLoadLevel());
         Ptr<Packet> packetToDst = Create<Packet>();
         SocketIpTtlTag gratTag;
         gratTag.SetTtl(toDst.GetHop());
@@ -1660,13 +2398,26 @@ RoutingProtocol::RecvReply(Ptr<Packet> p, Ipv4Address receiver, Ipv4Address send
     // If RREP is Hello message
     if (dst == rrepHeader.GetOrigin())
     {
+        LoadExtensionHeader loadHeader;
+        if (p->GetSize() >= loadHeader.GetSerializedSize())
+        {
+            p->PeekHeader(loadHeader);
+            if (loadHeader.IsValid())
+            {
+                NS_LOG_LOGIC("Load of neighbor " << dst << ": " << loadHeader);
+                m_neighborLoad[dst] = {loadHeader.GetQueueFill(),
+                                       loadHeader.GetMacDrops(),
+                                       loadHeader.GetLoadLevel(),
+                                       Simulator::Now()};
+            }
+        }
         ProcessHello(rrepHeader, receiver);
         return;
     }
 
-    if(rrepHeader.Get_congestion_flag()==1)
+    if (rrepHeader.Get_congestion_flag() >= m_congestedLoadLevel)
     {
-        m_congestion_count++;
+        AddNeighborCongestion(sender);
     }
 
     /*
@@ -1681,11 +2432,20 @@ RoutingProtocol::RecvReply(Ptr<Packet> p, Ipv4Address receiver, Ipv4Address send
      * message,
      * -  and the destination sequence number is the Destination Sequence Number in the RREP
      * message.
+     * A nonzero Prefix Size makes the entry a route to the subnet of the destination.
      */
+    uint8_t prefixSize = rrepHeader.GetPrefixSize();
+    if (prefixSize > 31)
+    {
+        NS_LOG_DEBUG("Ignore invalid prefix size " << uint32_t(prefixSize));
+        prefixSize = 0;
+    }
+    Ipv4Address routeDst =
+        prefixSize == 0 ? dst : dst.CombineMask(Ipv4Mask(~uint32_t(0) << (32 - prefixSize)));
     Ptr<NetDevice> dev = m_ipv4->GetNetDevice(m_ipv4->GetInterfaceForAddress(receiver));
     RoutingTableEntry newEntry(
         /*dev=*/dev,
-        /*dst=*/dst,
+        /*dst=*/routeDst,
         /*vSeqNo=*/true,
         /*seqNo=*/rrepHeader.GetDstSeqno(),
         /*iface=*/m_ipv4->GetAddress(m_ipv4->GetInterfaceForAddress(receiver), 0),
@@ -1693,8 +2453,28 @@ RoutingProtocol::RecvReply(Ptr<Packet> p, Ipv4Address receiver, Ipv4Address send
         /*nextHop=*/sender,
         /*lifetime=*/rrepHeader.GetLifeTime(),
         rrepHeader.Get_congestion_flag());
+    newEntry.SetPrefixSize(prefixSize);
     RoutingTableEntry toDst;
-    if (m_routingTable.LookupRoute(dst, toDst))
+    auto collected = m_collectedReplies.find(dst);
+    if (collected != m_collectedReplies.end() && IsMyOwnAddress(rrepHeader.GetOrigin()))
+    {
+        // Within the reply collection window the originator switches to the best reply so far
+        double metric = GetReplyMetric(hop, rrepHeader.Get_congestion_flag(), sender);
+        int32_t newer = int32_t(rrepHeader.GetDstSeqno()) - int32_t(collected->second.seqNo);
+        if (newer > 0 || (newer == 0 && metric < collected->second.metric))
+        {
+            NS_LOG_LOGIC("Better reply for " << dst << " through " << sender << ", metric "
+                                             << metric);
+            collected->second.metric = metric;
+            collected->second.seqNo = rrepHeader.GetDstSeqno();
+            collected->second.routeDst = routeDst;
+            if (!m_routingTable.Update(newEntry))
+            {
+                m_routingTable.AddRoute(newEntry);
+            }
+        }
+    }
+    else if (m_routingTable.LookupRoute(routeDst, toDst))
     {
         // The existing entry is updated only in the following circumstances:
         if (
@@ -1711,10 +2491,29 @@ RoutingProtocol::RecvReply(Ptr<Packet> p, Ipv4Address receiver, Ipv4Address send
 
             // (iv) the sequence numbers are the same, and the New Hop Count is smaller than the
             // hop count in route table entry.
-            (rrepHeader.GetDstSeqno() == toDst.GetSeqNo() && hop < toDst.GetHop()))
+            (rrepHeader.GetDstSeqno() == toDst.GetSeqNo() && hop < toDst.GetHop()) ||
+
+            // (v) the sequence numbers and hop counts are the same, and the RREP reports a lower
+            // load level than the one in the route table entry. In multipath mode such a reply
+            // becomes an alternate path instead.
+            (m_multipathMaxPaths <= 1 && rrepHeader.GetDstSeqno() == toDst.GetSeqNo() &&
+             hop == toDst.GetHop() &&
+             int32_t(rrepHeader.Get_congestion_flag()) < toDst.GetCongestionFlag()))
         {
             m_routingTable.Update(newEntry);
         }
+        // In multipath mode, a reply for the same sequence number through another neighbor at
+        // the same distance is kept as an alternate path. Paths of equal hop count to the same
+        // sequence number cannot form a loop.
+        else if (m_multipathMaxPaths > 1 && toDst.GetFlag() == VALID &&
+                 rrepHeader.GetDstSeqno() == toDst.GetSeqNo() && hop == toDst.GetHop())
+        {
+            Ipv4InterfaceAddress iface =
+                m_ipv4->GetAddress(m_ipv4->GetInterfaceForAddress(receiver), 0);
+            m_routingTable.ModifyRoute(routeDst, [&](RoutingTableEntry& rt) {
+                rt.AddAlternate(sender, dev, iface, hop, m_multipathMaxPaths);
+            });
+        }
     }
     else
     {
@@ -1731,44 +2530,89 @@ RoutingProtocol::RecvReply(Ptr<Packet> p, Ipv4Address receiver, Ipv4Address send
     NS_LOG_LOGIC("receiver " << receiver << " origin " << rrepHeader.GetOrigin());
     if (IsMyOwnAddress(rrepHeader.GetOrigin()))
     {
+        if (collected != m_collectedReplies.end())
+        {
+            return;
+        }
+        bool answered = false;
         if (toDst.GetFlag() == IN_SEARCH)
         {
             m_routingTable.Update(newEntry);
             m_addressReqTimer[dst].Cancel();
             m_addressReqTimer.erase(dst);
+            answered = true;
         }
-        m_routingTable.LookupRoute(dst, toDst);
+        else if (routeDst != dst)
+        {
+            // The route discovery for dst was answered with a route to its subnet
+            RoutingTableEntry toHost;
+            if (m_routingTable.LookupRoute(dst, toHost) && toHost.GetFlag() == IN_SEARCH)
+            {
+                m_routingTable.DeleteRoute(dst);
+                m_addressReqTimer[dst].Cancel();
+                m_addressReqTimer.erase(dst);
+                answered = true;
+            }
+        }
+        if (answered && m_replyCollectionWindow.IsStrictlyPositive())
+        {
+            NS_LOG_LOGIC("Collect replies for " << dst << " during "
+                                                << m_replyCollectionWindow.As(Time::MS));
+            CollectedReply& reply = m_collectedReplies[dst];
+            reply.metric = GetReplyMetric(hop, rrepHeader.Get_congestion_flag(), sender);
+            reply.seqNo = rrepHeader.GetDstSeqno();
+            reply.routeDst = routeDst;
+            reply.timer = Timer(Timer::CANCEL_ON_DESTROY);
+            reply.timer.SetFunction(&RoutingProtocol::ReplyCollectionExpire, this);
+            reply.timer.SetArguments(dst);
+            reply.timer.Schedule(m_replyCollectionWindow);
+            return;
+        }
+        m_routingTable.LookupRoute(routeDst, toDst);
         SendPacketFromQueue(dst, toDst.GetRoute());
         return;
     }
 
-    RoutingTableEntry toOrigin;
-    if (!m_routingTable.LookupRoute(rrepHeader.GetOrigin(), toOrigin) ||
-        toOrigin.GetFlag() == IN_SEARCH)
+    bool toOriginFound = false;
+    Ipv4Address originNextHop;
+    Ipv4InterfaceAddress originIface;
+    m_routingTable.ModifyRoute(rrepHeader.GetOrigin(), [&](RoutingTableEntry& toOrigin) {
+        if (toOrigin.GetFlag() == IN_SEARCH)
+        {
+            return;
+        }
+        toOrigin.SetLifeTime(std::max(m_activeRouteTimeout, toOrigin.GetLifeTime()));
+        originNextHop = toOrigin.GetNextHop();
+        originIface = toOrigin.GetInterface();
+        toOriginFound = true;
+    });
+    if (!toOriginFound)
     {
         return; // Impossible! drop.
     }
-    toOrigin.SetLifeTime(std::max(m_activeRouteTimeout, toOrigin.GetLifeTime()));
-    m_routingTable.Update(toOrigin);
 
     // Update information about precursors
-    if (m_routingTable.LookupValidRoute(rrepHeader.GetDst(), toDst))
-    {
-        toDst.InsertPrecursor(toOrigin.GetNextHop());
-        m_routingTable.Update(toDst);
-
-        RoutingTableEntry toNextHopToDst;
-        m_routingTable.LookupRoute(toDst.GetNextHop(), toNextHopToDst);
-        toNextHopToDst.InsertPrecursor(toOrigin.GetNextHop());
-        m_routingTable.Update(toNextHopToDst);
-
-        toOrigin.InsertPrecursor(toDst.GetNextHop());
-        m_routingTable.Update(toOrigin);
-
-        RoutingTableEntry toNextHopToOrigin;
-        m_routingTable.LookupRoute(toOrigin.GetNextHop(), toNextHopToOrigin);
-        toNextHopToOrigin.InsertPrecursor(toDst.GetNextHop());
-        m_routingTable.Update(toNextHopToOrigin);
+    bool toDstValid = false;
+    Ipv4Address dstNextHop;
+    m_routingTable.ModifyRoute(routeDst, [&](RoutingTableEntry& rt) {
+        if (rt.GetFlag() == VALID)
+        {
+            rt.InsertPrecursor(originNextHop);
+            dstNextHop = rt.GetNextHop();
+            toDstValid = true;
+        }
+    });
+    if (toDstValid)
+    {
+        m_routingTable.ModifyRoute(dstNextHop, [originNextHop](RoutingTableEntry& rt) {
+            rt.InsertPrecursor(originNextHop);
+        });
+        m_routingTable.ModifyRoute(rrepHeader.GetOrigin(), [dstNextHop](RoutingTableEntry& rt) {
+            rt.InsertPrecursor(dstNextHop);
+        });
+        m_routingTable.ModifyRoute(originNextHop, [dstNextHop](RoutingTableEntry& rt) {
+            rt.InsertPrecursor(dstNextHop);
+        });
     }
     SocketIpTtlTag tag;
     p->RemovePacketTag(tag);
@@ -1776,14 +2620,16 @@ RoutingProtocol::RecvReply(Ptr<Packet> p, Ipv4Address receiver, Ipv4Address send
     {
         NS_LOG_DEBUG("TTL exceeded. Drop RREP destination " << dst << " origin "
                                                             << rrepHeader.GetOrigin());
-
-        if(m_congestion_count > 0)
-        {
-            m_congestion_count--;
-        }
         return;
     }
 
+    // The RREP carries the highest load level along the path
+    uint8_t loadLevel = GetLoadLevel();
+    if (loadLevel > rrepHeader.Get_congestion_flag())
+    {
+        rrepHeader.Set_congestion_flag(loadLevel);
+    }
+
     Ptr<Packet> packet = Create<Packet>();
     SocketIpTtlTag ttl;
     ttl.SetTtl(tag.GetTtl() - 1);
@@ -1791,22 +2637,19 @@ RoutingProtocol::RecvReply(Ptr<Packet> p, Ipv4Address receiver, Ipv4Address send
     packet->AddHeader(rrepHeader);
     TypeHeader tHeader(AODVTYPE_RREP);
     packet->AddHeader(tHeader);
-    Ptr<Socket> socket = FindSocketWithInterfaceAddress(toOrigin.GetInterface());
+    Ptr<Socket> socket = FindSocketWithInterfaceAddress(originIface);
     NS_ASSERT(socket);
-    socket->SendTo(packet, 0, InetSocketAddress(toOrigin.GetNextHop(), AODV_PORT));
+    socket->SendTo(packet, 0, InetSocketAddress(originNextHop, AODV_PORT));
 }
 
 void
 RoutingProtocol::RecvReplyAck(Ipv4Address neighbor)
 {
     NS_LOG_FUNCTION(this);
-    RoutingTableEntry rt;
-    if (m_routingTable.LookupRoute(neighbor, rt))
-    {
+    m_routingTable.ModifyRoute(neighbor, [](RoutingTableEntry& rt) {
         rt.m_ackTimer.Cancel();
         rt.SetFlag(VALID);
-        m_routingTable.Update(rt);
-    }
+    });
 }
 
 void
@@ -1818,34 +2661,31 @@ RoutingProtocol::ProcessHello(const RrepHeader& rrepHeader, Ipv4Address receiver
      * SHOULD make sure that it has an active route to the neighbor, and
      * create one if necessary.
      */
-    RoutingTableEntry toNeighbor;
-    if (!m_routingTable.LookupRoute(rrepHeader.GetDst(), toNeighbor))
+    Ptr<NetDevice> dev = m_ipv4->GetNetDevice(m_ipv4->GetInterfaceForAddress(receiver));
+    Ipv4InterfaceAddress iface = m_ipv4->GetAddress(m_ipv4->GetInterfaceForAddress(receiver), 0);
+    Time helloLifetime = Time(m_allowedHelloLoss * m_helloInterval);
+    if (!m_routingTable.ModifyRoute(rrepHeader.GetDst(), [&](RoutingTableEntry& toNeighbor) {
+            toNeighbor.SetLifeTime(std::max(helloLifetime, toNeighbor.GetLifeTime()));
+            toNeighbor.SetSeqNo(rrepHeader.GetDstSeqno());
+            toNeighbor.SetValidSeqNo(true);
+            toNeighbor.SetFlag(VALID);
+            toNeighbor.SetOutputDevice(dev);
+            toNeighbor.SetInterface(iface);
+            toNeighbor.SetHop(1);
+            toNeighbor.SetNextHop(rrepHeader.GetDst());
+        }))
     {
-        Ptr<NetDevice> dev = m_ipv4->GetNetDevice(m_ipv4->GetInterfaceForAddress(receiver));
         RoutingTableEntry newEntry(
             /*dev=*/dev,
             /*dst=*/rrepHeader.GetDst(),
             /*vSeqNo=*/true,
             /*seqNo=*/rrepHeader.GetDstSeqno(),
-            /*iface=*/m_ipv4->GetAddress(m_ipv4->GetInterfaceForAddress(receiver), 0),
+            /*iface=*/iface,
             /*hops=*/1,
             /*nextHop=*/rrepHeader.GetDst(),
             /*lifetime=*/rrepHeader.GetLifeTime());
         m_routingTable.AddRoute(newEntry);
     }
-    else
-    {
-        toNeighbor.SetLifeTime(
-            std::max(Time(m_allowedHelloLoss * m_helloInterval), toNeighbor.GetLifeTime()));
-        toNeighbor.SetSeqNo(rrepHeader.GetDstSeqno());
-        toNeighbor.SetValidSeqNo(true);
-        toNeighbor.SetFlag(VALID);
-        toNeighbor.SetOutputDevice(m_ipv4->GetNetDevice(m_ipv4->GetInterfaceForAddress(receiver)));
-        toNeighbor.SetInterface(m_ipv4->GetAddress(m_ipv4->GetInterfaceForAddress(receiver), 0));
-        toNeighbor.SetHop(1);
-        toNeighbor.SetNextHop(rrepHeader.GetDst());
-        m_routingTable.Update(toNeighbor);
-    }
     if (m_enableHello)
     {
         m_nb.Update(rrepHeader.GetDst(), Time(m_allowedHelloLoss * m_helloInterval));
@@ -1858,25 +2698,61 @@ RoutingProtocol::RecvError(Ptr<Packet> p, Ipv4Address src)
     NS_LOG_FUNCTION(this << " from " << src);
     RerrHeader rerrHeader;
     p->RemoveHeader(rerrHeader);
+    std::map<Ipv4Address, uint32_t> reported;
+    std::pair<Ipv4Address, uint32_t> un;
+    while (rerrHeader.RemoveUnDestination(un))
+    {
+        reported.insert(un);
+    }
+    // Destinations still reachable through another path are not reported further
+    m_routingTable.FailOverNextHop(src, reported);
     std::map<Ipv4Address, uint32_t> dstWithNextHopSrc;
     std::map<Ipv4Address, uint32_t> unreachable;
     m_routingTable.GetListOfDestinationWithNextHop(src, dstWithNextHopSrc);
-    std::pair<Ipv4Address, uint32_t> un;
-    while (rerrHeader.RemoveUnDestination(un))
+    for (auto i = reported.begin(); i != reported.end(); ++i)
     {
-        for (auto i = dstWithNextHopSrc.begin(); i != dstWithNextHopSrc.end(); ++i)
+        if (dstWithNextHopSrc.find(i->first) != dstWithNextHopSrc.end())
         {
-            if (i->first == un.first)
-            {
-                unreachable.insert(un);
-            }
+            unreachable.insert(*i);
         }
     }
 
-    std::vector<Ipv4Address> precursors;
-    for (auto i = unreachable.begin(); i != unreachable.end();)
+    PrecursorSet precursors;
+    if (m_rerrCoalescingWindow.IsStrictlyPositive())
     {
-        if (!rerrHeader.AddUnDestination(i->first, i->second))
+        for (auto i = unreachable.begin(); i != unreachable.end(); ++i)
+        {
+            RoutingTableEntry toDst;
+            m_routingTable.LookupRoute(i->first, toDst);
+            toDst.GetPrecursors(precursors);
+        }
+        QueueRerr(unreachable, precursors.GetAddresses());
+    }
+    else
+    {
+        for (auto i = unreachable.begin(); i != unreachable.end();)
+        {
+            if (!rerrHeader.AddUnDestination(i->first, i->second))
+            {
+                TypeHeader typeHeader(AODVTYPE_RERR);
+                Ptr<Packet> packet = Create<Packet>();
+                SocketIpTtlTag tag;
+                tag.SetTtl(1);
+                packet->AddPacketTag(tag);
+                packet->AddHeader(rerrHeader);
+                packet->AddHeader(typeHeader);
+                SendRerrMessage(packet, precursors.GetAddresses());
+                rerrHeader.Clear();
+            }
+            else
+            {
+                RoutingTableEntry toDst;
+                m_routingTable.LookupRoute(i->first, toDst);
+                toDst.GetPrecursors(precursors);
+                ++i;
+            }
+        }
+        if (rerrHeader.GetDestCount() != 0)
         {
             TypeHeader typeHeader(AODVTYPE_RERR);
             Ptr<Packet> packet = Create<Packet>();
@@ -1885,33 +2761,17 @@ RoutingProtocol::RecvError(Ptr<Packet> p, Ipv4Address src)
             packet->AddPacketTag(tag);
             packet->AddHeader(rerrHeader);
             packet->AddHeader(typeHeader);
-            SendRerrMessage(packet, precursors);
-            rerrHeader.Clear();
-        }
-        else
-        {
-            RoutingTableEntry toDst;
-            m_routingTable.LookupRoute(i->first, toDst);
-            toDst.GetPrecursors(precursors);
-            ++i;
+            SendRerrMessage(packet, precursors.GetAddresses());
         }
     }
-    if (rerrHeader.GetDestCount() != 0)
-    {
-        TypeHeader typeHeader(AODVTYPE_RERR);
-        Ptr<Packet> packet = Create<Packet>();
-        SocketIpTtlTag tag;
-        tag.SetTtl(1);
-        packet->AddPacketTag(tag);
-        packet->AddHeader(rerrHeader);
-        packet->AddHeader(typeHeader);
-        SendRerrMessage(packet, precursors);
-    }
     m_routingTable.InvalidateRoutesWithDst(unreachable);
 
-    if(m_congestion_count > 0)
+    // The routes through the neighbor are broken, so is the congestion it reported on them
+    if (m_neighborCongestion.find(src) != m_neighborCongestion.end())
     {
-        m_congestion_count--;
+        m_neighborCongestionClearedTrace(src, GetNeighborCongestion(src));
+        m_neighborCongestion.erase(src);
+        UpdateCongestion();
     }
 }
 
@@ -1919,13 +2779,21 @@ void
 RoutingProtocol::RouteRequestTimerExpire(Ipv4Address dst)
 {
     NS_LOG_LOGIC(this);
-    RoutingTableEntry toDst;
-    if (m_routingTable.LookupValidRoute(dst, toDst))
+    const RoutingTableEntry* route = m_routingTable.LookupRoute(dst);
+    if (route != nullptr && route->GetFlag() == VALID)
     {
-        SendPacketFromQueue(dst, toDst.GetRoute());
+        Ptr<Ipv4Route> ipv4Route = route->GetRoute();
+        if (route->GetDestination() != dst)
+        {
+            // A prefix route to the subnet of dst was found in the meantime
+            m_routingTable.DeleteRoute(dst);
+        }
+        SendPacketFromQueue(dst, ipv4Route);
         NS_LOG_LOGIC("route to " << dst << " found");
         return;
     }
+    RoutingTableEntry toDst;
+    m_routingTable.LookupRoute(dst, toDst);
     /*
      *  If a route discovery has been attempted RreqRetries times at the maximum TTL without
      *  receiving any RREP, all data packets destined for the corresponding destination SHOULD be
@@ -1958,6 +2826,29 @@ RoutingProtocol::RouteRequestTimerExpire(Ipv4Address dst)
     }
 }
 
+void
+RoutingProtocol::ReplyCollectionExpire(Ipv4Address dst)
+{
+    NS_LOG_LOGIC(this << dst);
+    auto collected = m_collectedReplies.find(dst);
+    if (collected == m_collectedReplies.end())
+    {
+        return;
+    }
+    Ipv4Address routeDst = collected->second.routeDst;
+    m_collectedReplies.erase(collected);
+    RoutingTableEntry toDst;
+    if (m_routingTable.LookupRoute(routeDst, toDst) && toDst.GetFlag() == VALID)
+    {
+        SendPacketFromQueue(dst, toDst.GetRoute());
+    }
+    else if (m_queue.Find(dst))
+    {
+        NS_LOG_LOGIC("Route to " << dst << " lost during reply collection");
+        SendRequest(dst);
+    }
+}
+
 void
 RoutingProtocol::HelloTimerExpire()
 {
@@ -1994,6 +2885,41 @@ RoutingProtocol::RerrRateLimitTimerExpire()
     m_rerrRateLimitTimer.Schedule(Seconds(1));
 }
 
+uint64_t
+RoutingProtocol::GetMemoryUsage()
+{
+    // A node of a std::map holds the color and three links besides the value
+    const uint64_t treeNode = 4 * sizeof(void*);
+    m_routingTableMemory = m_routingTable.GetMemoryUsage();
+    // GetSize() drops the expired entries first
+    m_queueMemory = uint64_t(m_queue.GetSize()) * sizeof(QueueEntry);
+    m_rreqIdCacheMemory =
+        uint64_t(m_rreqIdCache.GetSize()) * (sizeof(Ipv4Address) + sizeof(uint32_t) + sizeof(Time));
+    m_requestTimerMemory = uint64_t(m_addressReqTimer.size()) *
+                           (treeNode + sizeof(std::pair<const Ipv4Address, Timer>));
+    m_memoryUsage =
+        m_routingTableMemory + m_queueMemory + m_rreqIdCacheMemory + m_requestTimerMemory;
+    return m_memoryUsage;
+}
+
+void
+RoutingProtocol::MemoryTimerExpire()
+{
+    NS_LOG_FUNCTION(this);
+    uint64_t usage = GetMemoryUsage();
+    if (m_memoryBudget != 0 && usage > m_memoryBudget)
+    {
+        // The routing table gets what the other structures leave of the budget
+        uint64_t others = usage - m_routingTableMemory;
+        uint64_t tableBudget = m_memoryBudget > others ? m_memoryBudget - others : 0;
+        uint32_t evicted = m_routingTable.EnforceMemoryBudget(tableBudget);
+        usage = GetMemoryUsage();
+        NS_LOG_DEBUG("Memory budget " << m_memoryBudget << " exceeded, evicted " << evicted
+                                      << " routes, now using " << usage << " bytes");
+    }
+    m_memoryTimer.Schedule(m_memoryCheckInterval);
+}
+
 void
 RoutingProtocol::AckTimerExpire(Ipv4Address neighbor, Time blacklistTimeout)
 {
@@ -2010,7 +2936,16 @@ RoutingProtocol::SendHello()
      *   Destination Sequence Number    The node's latest sequence number.
      *   Hop Count                      0
      *   Lifetime                       AllowedHelloLoss * HelloInterval
+     * followed, if enabled, by a load extension.
      */
+    LoadExtensionHeader loadHeader;
+    if (m_helloLoadExtension)
+    {
+        loadHeader = LoadExtensionHeader(double(m_queue.GetSize()) /
+                                             std::max(m_maxQueueLen, uint32_t(1)),
+                                         GetRecentMacDrops(),
+                                         GetLoadLevel());
+    }
     for (auto j = m_socketAddresses.begin(); j != m_socketAddresses.end(); ++j)
     {
         Ptr<Socket> socket = j->first;
@@ -2025,6 +2960,10 @@ RoutingProtocol::SendHello()
         SocketIpTtlTag tag;
         tag.SetTtl(1);
         packet->AddPacketTag(tag);
+        if (m_helloLoadExtension)
+        {
+            packet->AddHeader(loadHeader);
+        }
         packet->AddHeader(helloHeader);
         TypeHeader tHeader(AODVTYPE_RREP);
         packet->AddHeader(tHeader);
@@ -2072,7 +3011,7 @@ RoutingProtocol::SendRerrWhenBreaksLinkToNextHop(Ipv4Address nextHop)
 {
     NS_LOG_FUNCTION(this << nextHop);
     RerrHeader rerrHeader;
-    std::vector<Ipv4Address> precursors;
+    PrecursorSet precursors;
     std::map<Ipv4Address, uint32_t> unreachable;
 
     RoutingTableEntry toNextHop;
@@ -2082,12 +3021,48 @@ RoutingProtocol::SendRerrWhenBreaksLinkToNextHop(Ipv4Address nextHop)
     }
     toNextHop.GetPrecursors(precursors);
     rerrHeader.AddUnDestination(nextHop, toNextHop.GetSeqNo());
+    // Destinations still reachable through another path are not reported
+    m_routingTable.FailOverNextHop(nextHop);
     m_routingTable.GetListOfDestinationWithNextHop(nextHop, unreachable);
-    for (auto i = unreachable.begin(); i != unreachable.end();)
+    if (m_rerrCoalescingWindow.IsStrictlyPositive())
+    {
+        for (auto i = unreachable.begin(); i != unreachable.end(); ++i)
+        {
+            RoutingTableEntry toDst;
+            m_routingTable.LookupRoute(i->first, toDst);
+            toDst.GetPrecursors(precursors);
+        }
+        std::map<Ipv4Address, uint32_t> reported = unreachable;
+        reported.insert(std::make_pair(nextHop, toNextHop.GetSeqNo()));
+        QueueRerr(reported, precursors.GetAddresses());
+    }
+    else
     {
-        if (!rerrHeader.AddUnDestination(i->first, i->second))
+        for (auto i = unreachable.begin(); i != unreachable.end();)
+        {
+            if (!rerrHeader.AddUnDestination(i->first, i->second))
+            {
+                NS_LOG_LOGIC("Send RERR message with maximum size.");
+                TypeHeader typeHeader(AODVTYPE_RERR);
+                Ptr<Packet> packet = Create<Packet>();
+                SocketIpTtlTag tag;
+                tag.SetTtl(1);
+                packet->AddPacketTag(tag);
+                packet->AddHeader(rerrHeader);
+                packet->AddHeader(typeHeader);
+                SendRerrMessage(packet, precursors.GetAddresses());
+                rerrHeader.Clear();
+            }
+            else
+            {
+                RoutingTableEntry toDst;
+                m_routingTable.LookupRoute(i->first, toDst);
+                toDst.GetPrecursors(precursors);
+                ++i;
+            }
+        }
+        if (rerrHeader.GetDestCount() != 0)
         {
-            NS_LOG_LOGIC("Send RERR message with maximum size.");
             TypeHeader typeHeader(AODVTYPE_RERR);
             Ptr<Packet> packet = Create<Packet>();
             SocketIpTtlTag tag;
@@ -2095,28 +3070,9 @@ RoutingProtocol::SendRerrWhenBreaksLinkToNextHop(Ipv4Address nextHop)
             packet->AddPacketTag(tag);
             packet->AddHeader(rerrHeader);
             packet->AddHeader(typeHeader);
-            SendRerrMessage(packet, precursors);
-            rerrHeader.Clear();
-        }
-        else
-        {
-            RoutingTableEntry toDst;
-            m_routingTable.LookupRoute(i->first, toDst);
-            toDst.GetPrecursors(precursors);
-            ++i;
+            SendRerrMessage(packet, precursors.GetAddresses());
         }
     }
-    if (rerrHeader.GetDestCount() != 0)
-    {
-        TypeHeader typeHeader(AODVTYPE_RERR);
-        Ptr<Packet> packet = Create<Packet>();
-        SocketIpTtlTag tag;
-        tag.SetTtl(1);
-        packet->AddPacketTag(tag);
-        packet->AddHeader(rerrHeader);
-        packet->AddHeader(typeHeader);
-        SendRerrMessage(packet, precursors);
-    }
     unreachable.insert(std::make_pair(nextHop, toNextHop.GetSeqNo()));
     m_routingTable.InvalidateRoutesWithDst(unreachable);
 }
@@ -2127,6 +3083,21 @@ RoutingProtocol::SendRerrWhenNoRouteToForward(Ipv4Address dst,
                                               Ipv4Address origin)
 {
     NS_LOG_FUNCTION(this);
+    RoutingTableEntry toOrigin;
+    if (m_rerrCoalescingWindow.IsStrictlyPositive())
+    {
+        std::map<Ipv4Address, uint32_t> unreachable;
+        unreachable.insert(std::make_pair(dst, dstSeqNo));
+        if (m_routingTable.LookupValidRoute(origin, toOrigin))
+        {
+            QueueRerr(unreachable, {toOrigin.GetNextHop()});
+        }
+        else
+        {
+            QueueRerr(unreachable, {}, /*broadcast=*/true);
+        }
+        return;
+    }
     // A node SHOULD NOT originate more than RERR_RATELIMIT RERR messages per second.
     if (m_rerrCount == m_rerrRateLimit)
     {
@@ -2140,7 +3111,6 @@ RoutingProtocol::SendRerrWhenNoRouteToForward(Ipv4Address dst,
     }
     RerrHeader rerrHeader;
     rerrHeader.AddUnDestination(dst, dstSeqNo);
-    RoutingTableEntry toOrigin;
     Ptr<Packet> packet = Create<Packet>();
     SocketIpTtlTag tag;
     tag.SetTtl(1);
@@ -2259,6 +3229,149 @@ RoutingProtocol::SendRerrMessage(Ptr<Packet> packet, std::vector<Ipv4Address> pr
     }
 }
 
+void
+RoutingProtocol::QueueRerr(const std::map<Ipv4Address, uint32_t>& unreachable,
+                           const std::vector<Ipv4Address>& precursors,
+                           bool broadcast)
+{
+    NS_LOG_FUNCTION(this << unreachable.size() << precursors.size() << broadcast);
+    std::vector<PendingRerr*> rerrs;
+    if (broadcast)
+    {
+        for (auto j = m_socketAddresses.begin(); j != m_socketAddresses.end(); ++j)
+        {
+            PendingRerr& rerr = m_pendingRerrs[j->second.GetLocal()];
+            rerr.iface = j->second;
+            rerr.broadcast = true;
+            rerrs.push_back(&rerr);
+        }
+    }
+    else
+    {
+        // Only the interfaces with precursors for the broken routes get the RERR
+        for (auto i = precursors.begin(); i != precursors.end(); ++i)
+        {
+            RoutingTableEntry toPrecursor;
+            if (!m_routingTable.LookupValidRoute(*i, toPrecursor))
+            {
+                continue;
+            }
+            auto inserted = m_pendingRerrs.insert(
+                std::make_pair(toPrecursor.GetInterface().GetLocal(),
+                               PendingRerr{toPrecursor.GetInterface(), {}, {}, false}));
+            PendingRerr& rerr = inserted.first->second;
+            if (std::find(rerr.precursors.begin(), rerr.precursors.end(), *i) ==
+                rerr.precursors.end())
+            {
+                rerr.precursors.push_back(*i);
+            }
+            if (std::find(rerrs.begin(), rerrs.end(), &rerr) == rerrs.end())
+            {
+                rerrs.push_back(&rerr);
+            }
+        }
+    }
+    if (rerrs.empty())
+    {
+        NS_LOG_LOGIC("No precursors");
+        return;
+    }
+    for (auto rerr = rerrs.begin(); rerr != rerrs.end(); ++rerr)
+    {
+        // The last report of a destination has the newest sequence number
+        for (auto i = unreachable.begin(); i != unreachable.end(); ++i)
+        {
+            (*rerr)->unreachable[i->first] = i->second;
+        }
+    }
+    if (!m_rerrCoalescingTimer.IsRunning())
+    {
+        m_rerrCoalescingTimer.SetFunction(&RoutingProtocol::RerrCoalescingTimerExpire, this);
+        m_rerrCoalescingTimer.Schedule(m_rerrCoalescingWindow);
+    }
+}
+
+void
+RoutingProtocol::RerrCoalescingTimerExpire()
+{
+    NS_LOG_FUNCTION(this << m_pendingRerrs.size());
+    std::map<Ipv4Address, PendingRerr> pendingRerrs;
+    pendingRerrs.swap(m_pendingRerrs);
+    for (auto j = pendingRerrs.begin(); j != pendingRerrs.end(); ++j)
+    {
+        PendingRerr& rerr = j->second;
+        Ptr<Socket> socket = FindSocketWithInterfaceAddress(rerr.iface);
+        if (!socket)
+        {
+            NS_LOG_LOGIC("Interface " << j->first << " is down, drop its RERR");
+            continue;
+        }
+        // If there is only one precursor, RERR SHOULD be unicast toward that precursor.
+        // Send to all-hosts broadcast if on /32 addr, subnet-directed otherwise.
+        Ipv4Address destination;
+        if (!rerr.broadcast && rerr.precursors.size() == 1)
+        {
+            destination = rerr.precursors.front();
+        }
+        else if (rerr.iface.GetMask() == Ipv4Mask::GetOnes())
+        {
+            destination = Ipv4Address("255.255.255.255");
+        }
+        else
+        {
+            destination = rerr.iface.GetBroadcast();
+        }
+
+        RerrHeader rerrHeader;
+        // First destination of the RERR being filled
+        auto batch = rerr.unreachable.begin();
+        for (auto i = rerr.unreachable.begin(); i != rerr.unreachable.end();)
+        {
+            if (rerrHeader.AddUnDestination(i->first, i->second))
+            {
+                ++i;
+                if (i != rerr.unreachable.end())
+                {
+                    continue;
+                }
+            }
+            // A node SHOULD NOT originate more than RERR_RATELIMIT RERR messages per second.
+            if (m_rerrCount == m_rerrRateLimit)
+            {
+                NS_ASSERT(m_rerrRateLimitTimer.IsRunning());
+                NS_LOG_LOGIC("RerrRateLimit reached at "
+                             << Simulator::Now().As(Time::S) << " with timer delay left "
+                             << m_rerrRateLimitTimer.GetDelayLeft().As(Time::S)
+                             << "; delaying RERR");
+                // Queue the destinations not sent yet again, for when the rate limit allows
+                rerr.unreachable.erase(rerr.unreachable.begin(), batch);
+                m_pendingRerrs.insert(j, pendingRerrs.end());
+                m_rerrCoalescingTimer.Schedule(m_rerrRateLimitTimer.GetDelayLeft() +
+                                               MicroSeconds(100));
+                return;
+            }
+            NS_LOG_LOGIC("Send RERR with " << uint32_t(rerrHeader.GetDestCount())
+                                           << " destinations from interface "
+                                           << rerr.iface.GetLocal() << " to " << destination);
+            Ptr<Packet> packet = Create<Packet>();
+            SocketIpTtlTag tag;
+            tag.SetTtl(1);
+            packet->AddPacketTag(tag);
+            packet->AddHeader(rerrHeader);
+            packet->AddHeader(TypeHeader(AODVTYPE_RERR));
+            Simulator::Schedule(Time(MilliSeconds(m_uniformRandomVariable->GetInteger(0, 10))),
+                                &RoutingProtocol::SendTo,
+                                this,
+                                socket,
+                                packet,
+                                destination);
+            m_rerrCount++;
+            rerrHeader.Clear();
+            batch = i;
+        }
+    }
+}
+
 Ptr<Socket>
 RoutingProtocol::FindSocketWithInterfaceAddress(Ipv4InterfaceAddress addr) const
 {
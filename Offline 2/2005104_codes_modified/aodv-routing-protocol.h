@@ -28,8 +28,12 @@
 #include "ns3/node.h"
 #include "ns3/output-stream-wrapper.h"
 #include "ns3/random-variable-stream.h"
+#include "ns3/traced-callback.h"
+#include "ns3/traced-value.h"
 
 #include <map>
+#include <utility>
+#include <vector>
 
 namespace ns3
 {
@@ -78,6 +82,38 @@ class RoutingProtocol : public Ipv4RoutingProtocol
     void SetIpv4(Ptr<Ipv4> ipv4) override;
     void PrintRoutingTable(Ptr<OutputStreamWrapper> stream,
                            Time::Unit unit = Time::S) const override;
+    /**
+     * Write the routing table in binary form, see RoutingTable::Dump()
+     * \param stream the output stream
+     */
+    void DumpRoutingTable(Ptr<OutputStreamWrapper> stream) const;
+    /**
+     * Estimate the memory held by the routing state of the node and update the memory trace
+     * sources. The estimate covers the routing table with the precursor lists, the packet
+     * queue without the packet contents, the RREQ id cache and the route request timers.
+     * \returns the estimate in bytes
+     */
+    uint64_t GetMemoryUsage();
+
+    /**
+     * TracedCallback signature for the congestion estimate of a neighbor.
+     *
+     * \param [in] neighbor the address of the neighbor
+     * \param [in] congestion the estimate
+     */
+    typedef void (*NeighborCongestionTracedCallback)(Ipv4Address neighbor, double congestion);
+
+    /**
+     * TracedCallback signature for an RREQ.
+     *
+     * \param [in] header the RREQ header
+     */
+    typedef void (*RreqTracedCallback)(const RreqHeader& header);
+
+    /**
+     * \returns the congestion estimate of the node, the sum of the estimates of the neighbors
+     */
+    double GetCongestion() const;
 
     // Handle protocol parameters
     /**
@@ -182,6 +218,24 @@ class RoutingProtocol : public Ipv4RoutingProtocol
         return m_enableBroadcast;
     }
 
+    /**
+     * Set flat routing table flag
+     * \param f use the open-addressing hash table as routing table storage
+     */
+    void SetFlatRoutingTable(bool f)
+    {
+        m_routingTable.SetFlatStorage(f);
+    }
+
+    /**
+     * Get flat routing table flag
+     * \returns the flat routing table flag
+     */
+    bool GetFlatRoutingTable() const
+    {
+        return m_routingTable.IsFlatStorage();
+    }
+
     /**
      * Assign a fixed random variable stream number to the random variables
      * used by this model.  Return the number of streams (possibly zero) that
@@ -203,6 +257,88 @@ class RoutingProtocol : public Ipv4RoutingProtocol
      * \param mpdu the dropped MPDU
      */
     void NotifyTxError(WifiMacDropReason reason, Ptr<const WifiMpdu> mpdu);
+    /**
+     * Grade the local load from the occupancy of the packet queue, the occupancy of the Wi-Fi
+     * MAC queues and the recent MAC drops, whichever is highest.
+     * \returns the load level, from 0 (under a quarter of capacity) to 3 (over three quarters)
+     */
+    uint8_t GetLoadLevel();
+    /**
+     * \returns the number of recent MAC drops, each weighted down exponentially with its age
+     */
+    double GetRecentMacDrops() const;
+    /**
+     * Count a congested RREP in the congestion estimate of the neighbor it came from.
+     * \param neighbor the address of the neighbor
+     */
+    void AddNeighborCongestion(Ipv4Address neighbor);
+    /**
+     * \param neighbor the address of the neighbor
+     * \returns the number of congested RREPs received from the neighbor, each weighted down
+     * exponentially with its age
+     */
+    double GetNeighborCongestion(Ipv4Address neighbor) const;
+    /**
+     * Forget the neighbor congestion estimates that have decayed away and update the Congestion
+     * trace source. Reschedules itself while estimates are left.
+     */
+    void UpdateCongestion();
+    /**
+     * Get the probability of rebroadcasting an RREQ in gossip mode. It is 1 up to the GossipOnset
+     * congestion, falls linearly to GossipMinProbability at the CongestionThreshold and stays
+     * there.
+     * \returns the forwarding probability
+     */
+    double GetRreqForwardingProbability();
+    /**
+     * Rank a route offered by an RREP, lower is better. The metric adds to the hop count the
+     * reported load level and the congestion estimate of the neighbor the RREP came from, each
+     * weighted by its attribute.
+     * \param hops the hop count of the route
+     * \param loadLevel the load level reported for the route
+     * \param neighbor the next hop of the route
+     * \returns the metric
+     */
+    double GetReplyMetric(uint16_t hops, int32_t loadLevel, Ipv4Address neighbor) const;
+    /**
+     * \param neighbor the address of the neighbor
+     * \returns the load level in the last load extension of a hello from the neighbor, or 0 if
+     * there is none within AllowedHelloLoss * HelloInterval
+     */
+    uint8_t GetNeighborLoadLevel(Ipv4Address neighbor) const;
+    /**
+     * Forget stale neighbor loads and check whether every other neighbor with a known load is
+     * congested, so that an RREQ rebroadcast could only find congested routes.
+     * \param src the neighbor the RREQ came from, not counted
+     * \returns true if the other neighbors with a known load are all congested
+     */
+    bool IsNeighborhoodCongested(Ipv4Address src);
+    /**
+     * Move a flow off a path whose next hop reports congestion in its hellos, to the path with
+     * the least loaded next hop.
+     * \param rt the routing table entry
+     * \param path the path chosen for the flow
+     * \returns the path to use
+     */
+    uint32_t SelectUnloadedPath(const RoutingTableEntry& rt, uint32_t path) const;
+    /**
+     * Count a duplicate of an RREQ waiting for its rebroadcast, and cancel the rebroadcast once
+     * RreqSuppressionCount copies, the first one included, are heard
+     * \param origin the originator of the RREQ
+     * \param id the RREQ ID
+     */
+    void CountDuplicateRequest(Ipv4Address origin, uint32_t id);
+    /// Forget the RREQs whose rebroadcasts have all been sent
+    void PurgePendingRebroadcasts();
+    /**
+     * Answer an RREQ for its destination, as the destination itself, its gateway or an
+     * intermediate node with a fresh enough route. Otherwise raise the destination sequence number
+     * of the RREQ to the one of the route, if any, for the rebroadcast.
+     * \param rreqHeader the RREQ, or a copy of it for a destination of its extension
+     * \param src the neighbor the RREQ came from
+     * \returns true if the RREQ was answered, or dropped because the reply would make a loop
+     */
+    bool AnswerRequest(RreqHeader& rreqHeader, Ipv4Address src);
 
     // Protocol parameters.
     uint32_t m_rreqRetries; ///< Maximum number of retransmissions of RREQ with TTL = NetDiameter to
@@ -249,6 +385,12 @@ class RoutingProtocol : public Ipv4RoutingProtocol
                              ///< originated route discovery.
     bool m_enableHello;      ///< Indicates whether a hello messages enable
     bool m_enableBroadcast;  ///< Indicates whether a a broadcast data packets forwarding enable
+    /// Maximum number of equal-cost paths kept per destination
+    uint32_t m_multipathMaxPaths;
+    /// Subnet this node is a gateway for, if m_gatewayPrefixSize is not 0
+    Ipv4Address m_gatewayPrefix;
+    /// Prefix size of the subnet this node is a gateway for, 0 if it is not a gateway
+    uint8_t m_gatewayPrefixSize;
 
     /// IP protocol
     Ptr<Ipv4> m_ipv4;
@@ -280,7 +422,120 @@ class RoutingProtocol : public Ipv4RoutingProtocol
     /// Number of RERRs used for RERR rate control
     uint16_t m_rerrCount;
 
-    uint32_t m_congestion_count;
+    /// Congestion estimate of a neighbor
+    struct CongestionEstimate
+    {
+        double value;    ///< Estimate at the time of the last update
+        Time lastUpdate; ///< Time of the last update
+    };
+
+    /// Congestion estimate per neighbor, see GetNeighborCongestion()
+    std::map<Ipv4Address, CongestionEstimate> m_neighborCongestion;
+    /// Time constant of the decay of the congestion estimates
+    Time m_congestionDecayTime;
+    /// Congestion estimate of the node above which RREQs are dropped
+    double m_congestionThreshold;
+    /// Load level from which an RREP or a neighbor counts as congested
+    uint8_t m_congestedLoadLevel;
+    /// Period of the update of the congestion trace source while estimates decay
+    Time m_congestionUpdateInterval;
+    /// Rebroadcast RREQs with a probability falling with congestion instead of dropping them
+    bool m_gossipForwarding;
+    /// Congestion estimate of the node up to which RREQs are always rebroadcast in gossip mode
+    double m_gossipOnset;
+    /// Probability of rebroadcasting an RREQ at and above the congestion threshold in gossip mode
+    double m_gossipMinProbability;
+    /// Load level of an active route from which it is rediscovered proactively, 0 for never
+    uint8_t m_rediscoveryLoadLevel;
+    /// Time for which the originator collects RREPs after the first one, 0 for none
+    Time m_replyCollectionWindow;
+    /// Weight of the load level in GetReplyMetric(), in hops per level
+    double m_replyLoadWeight;
+    /// Weight of the neighbor congestion estimate in GetReplyMetric(), in hops per unit
+    double m_replyNeighborWeight;
+    /// Append a load extension to hellos and use the neighbor loads for forwarding decisions
+    bool m_helloLoadExtension;
+
+    /// Load of a neighbor, from the load extension of its hellos
+    struct NeighborLoad
+    {
+        double queueFill;  ///< Occupancy of the packet queue, from 0 to 1
+        uint8_t macDrops;  ///< Recent MAC drops
+        uint8_t loadLevel; ///< Load level
+        Time lastUpdate;   ///< Time of the hello
+    };
+
+    /// One-hop load map, see GetNeighborLoadLevel()
+    std::map<Ipv4Address, NeighborLoad> m_neighborLoad;
+
+    /// Number of copies of an RREQ, the first included, that cancel its rebroadcast, 0 to never
+    /// cancel it
+    uint32_t m_rreqSuppressionCount;
+
+    /// RREQ waiting for the jitter of its rebroadcast
+    struct PendingRebroadcast
+    {
+        uint32_t copies;            ///< Copies of the RREQ heard, the first one included
+        std::vector<EventId> sends; ///< Rebroadcast on each interface
+    };
+
+    /// RREQs waiting for their rebroadcast, by originator and RREQ ID
+    std::map<std::pair<Ipv4Address, uint32_t>, PendingRebroadcast> m_pendingRebroadcasts;
+
+    /// Time new destinations wait to be discovered together by one RREQ, 0 to send an RREQ per
+    /// destination
+    Time m_rreqBatchWindow;
+    /// Destinations waiting for the batched RREQ, in arrival order
+    std::vector<Ipv4Address> m_batchedDestinations;
+
+    /// Time unreachable destinations wait to be reported together in one RERR per interface, 0 to
+    /// send the RERRs immediately
+    Time m_rerrCoalescingWindow;
+
+    /// RERR of an interface waiting for the end of the coalescing window
+    struct PendingRerr
+    {
+        Ipv4InterfaceAddress iface;                  ///< Interface to send the RERR on
+        std::map<Ipv4Address, uint32_t> unreachable; ///< Unreachable destinations and seqnos
+        std::vector<Ipv4Address> precursors;         ///< Precursors reached on the interface
+        bool broadcast;                              ///< Broadcast even to a single precursor
+    };
+
+    /// RERRs waiting for the end of the coalescing window, by interface local address
+    std::map<Ipv4Address, PendingRerr> m_pendingRerrs;
+    /// Congestion estimate of the node, see GetCongestion()
+    TracedValue<double> m_congestion;
+    /// Trace of the congestion estimate of a neighbor, fired on each congested RREP from it
+    TracedCallback<Ipv4Address, double> m_neighborCongestionTrace;
+    /// Trace of the congestion estimate of a neighbor, fired when a RERR from it clears it
+    TracedCallback<Ipv4Address, double> m_neighborCongestionClearedTrace;
+    /// Trace of the RREQs dropped or not rebroadcast because of congestion
+    TracedCallback<const RreqHeader&> m_rreqCongestionDropTrace;
+    /// Time constant of the decay of the MAC drop count used by GetLoadLevel()
+    Time m_loadDropWindow;
+    /// Number of recent MAC drops that GetLoadLevel() grades as full load
+    uint32_t m_loadDropThreshold;
+    /// MAC drop count at m_lastMacDropTime, see GetRecentMacDrops()
+    double m_recentMacDrops;
+    /// Time of the last MAC drop
+    Time m_lastMacDropTime;
+    /// Best effort queue of the Wi-Fi MAC, by interface index
+    std::map<uint32_t, Ptr<WifiMacQueue>> m_macQueues;
+
+    /// Memory budget of the routing state in bytes, 0 for none
+    uint64_t m_memoryBudget;
+    /// Period of the memory accounting and budget enforcement, 0 to disable it
+    Time m_memoryCheckInterval;
+    /// Estimated memory of the routing table, in bytes
+    TracedValue<uint64_t> m_routingTableMemory;
+    /// Estimated memory of the packet queue, in bytes
+    TracedValue<uint64_t> m_queueMemory;
+    /// Estimated memory of the RREQ id cache, in bytes
+    TracedValue<uint64_t> m_rreqIdCacheMemory;
+    /// Estimated memory of the route request timers, in bytes
+    TracedValue<uint64_t> m_requestTimerMemory;
+    /// Estimated memory of all the routing state above, in bytes
+    TracedValue<uint64_t> m_memoryUsage;
 
   private:
     /// Start protocol operation
@@ -310,12 +565,26 @@ class RoutingProtocol : public Ipv4RoutingProtocol
                     const Ipv4Header& header,
                     UnicastForwardCallback ucb,
                     ErrorCallback ecb);
+    /**
+     * Hash the flow a packet belongs to, so that all packets of a flow take the same path
+     * \param p the packet, starting with the transport header
+     * \param header the IP header
+     * \returns the flow hash
+     */
+    static uint32_t FlowHash(Ptr<const Packet> p, const Ipv4Header& header);
     /**
      * Repeated attempts by a source node at route discovery for a single destination
      * use the expanding ring search technique.
      * \param dst the destination IP address
      */
     void ScheduleRreqRetry(Ipv4Address dst);
+    /**
+     * Start a proactive route discovery if the load level reported for an active route has
+     * reached RediscoveryLoadLevel. The level is acted on once, until a new RREP reports it.
+     * The route is looked up again, so the caller must not hold table entries across the call.
+     * \param dst the destination of the active route
+     */
+    void CheckRouteCongestion(Ipv4Address dst);
     /**
      * Set lifetime field in routing table entry to the maximum of existing lifetime and lt, if the
      * entry exists
@@ -337,6 +606,13 @@ class RoutingProtocol : public Ipv4RoutingProtocol
      * \returns true if the IP address is the node's IP address
      */
     bool IsMyOwnAddress(Ipv4Address src);
+    /**
+     * Test whether the node answers route requests for the provided address as the gateway of
+     * its subnet
+     * \param dst the destination IP address
+     * \returns true if dst is in the gateway prefix of the node
+     */
+    bool IsGatewayFor(Ipv4Address dst) const;
     /**
      * Find unicast socket with local interface address iface
      *
@@ -419,17 +695,46 @@ class RoutingProtocol : public Ipv4RoutingProtocol
      * \param dst destination address
      */
     void SendRequest(Ipv4Address dst);
+    /** Queue a destination for the batched RREQ, starting the batching window if needed
+     * \param dst destination address
+     */
+    void BatchRequest(Ipv4Address dst);
+    /// Send the batched RREQs, each for up to 1 + DestinationsExtensionHeader::MAX_DESTINATIONS
+    /// destinations
+    void SendBatchedRequest();
+    /** Start or continue the expanding ring search for a destination: mark its route IN_SEARCH,
+     * creating it if needed, and set the destination sequence number of the RREQ
+     * \param dst destination address
+     * \param rreqHeader route request header
+     * \returns the TTL of the RREQ
+     */
+    uint16_t StartSearch(Ipv4Address dst, RreqHeader& rreqHeader);
+    /** Send RREQ for a destination with an active route, keeping the route in use. The RREQ asks
+     * for a newer sequence number, so that the replies replace the route.
+     * \param dst destination address
+     */
+    void SendProactiveRequest(Ipv4Address dst);
+    /** Number the RREQ and broadcast it from each interface
+     * \param rreqHeader route request header with the destination fields set
+     * \param ttl the TTL of the RREQ
+     * \param destinations further destinations of the RREQ, appended as an extension if any
+     */
+    void BroadcastRequest(RreqHeader& rreqHeader,
+                          uint16_t ttl,
+                          const DestinationsExtensionHeader& destinations = {});
     /** Send RREP
      * \param rreqHeader route request header
      * \param toOrigin routing table entry to originator
      */
     void SendReply(const RreqHeader& rreqHeader, const RoutingTableEntry& toOrigin);
     /** Send RREP by intermediate node
-     * \param toDst routing table entry to destination
+     * \param dst the requested destination
+     * \param toDst routing table entry to destination, a prefix route if it covers dst
      * \param toOrigin routing table entry to originator
      * \param gratRep indicates whether a gratuitous RREP should be unicast to destination
      */
-    void SendReplyByIntermediateNode(RoutingTableEntry& toDst,
+    void SendReplyByIntermediateNode(Ipv4Address dst,
+                                     RoutingTableEntry& toDst,
                                      RoutingTableEntry& toOrigin,
                                      bool gratRep);
     /** Send RREP_ACK
@@ -453,6 +758,21 @@ class RoutingProtocol : public Ipv4RoutingProtocol
      * \param origin originating node IP address
      */
     void SendRerrWhenNoRouteToForward(Ipv4Address dst, uint32_t dstSeqNo, Ipv4Address origin);
+    /**
+     * Queue unreachable destinations for the RERR of each interface with a precursor to notify,
+     * starting the coalescing window if needed
+     * \param unreachable the unreachable destinations and their sequence numbers
+     * \param precursors the precursors to notify
+     * \param broadcast broadcast the RERR on every interface, whatever the precursors
+     */
+    void QueueRerr(const std::map<Ipv4Address, uint32_t>& unreachable,
+                   const std::vector<Ipv4Address>& precursors,
+                   bool broadcast = false);
+    /**
+     * Send the queued RERRs, one per interface unless it exceeds 255 destinations. The RERRs
+     * over the RERR rate limit are queued again, until the rate limit allows them.
+     */
+    void RerrCoalescingTimerExpire();
     /** @} */
 
     /**
@@ -475,6 +795,16 @@ class RoutingProtocol : public Ipv4RoutingProtocol
     Timer m_rerrRateLimitTimer;
     /// Reset RERR count and schedule RERR rate limit timer with delay 1 sec.
     void RerrRateLimitTimerExpire();
+    /// RREQ batching window timer
+    Timer m_rreqBatchTimer;
+    /// RERR coalescing window timer
+    Timer m_rerrCoalescingTimer;
+    /// Memory accounting timer
+    Timer m_memoryTimer;
+    /// Update the memory trace sources, enforce the memory budget and reschedule the timer.
+    void MemoryTimerExpire();
+    /// Congestion trace update timer, see UpdateCongestion()
+    Timer m_congestionTimer;
     /// Map IP address + RREQ timer.
     std::map<Ipv4Address, Timer> m_addressReqTimer;
     /**
@@ -482,6 +812,24 @@ class RoutingProtocol : public Ipv4RoutingProtocol
      * \param dst the destination IP address
      */
     void RouteRequestTimerExpire(Ipv4Address dst);
+
+    /// Best RREP received during the reply collection window of a destination
+    struct CollectedReply
+    {
+        double metric;        ///< Metric of the route, see GetReplyMetric()
+        uint32_t seqNo;       ///< Destination sequence number of the route
+        Ipv4Address routeDst; ///< Destination of the route entry, a subnet for a prefix route
+        Timer timer;          ///< End of the window
+    };
+
+    /// Replies being collected, by requested destination
+    std::map<Ipv4Address, CollectedReply> m_collectedReplies;
+    /**
+     * Close the reply collection window of a destination and send the queued packets over the
+     * best route found
+     * \param dst the destination IP address
+     */
+    void ReplyCollectionExpire(Ipv4Address dst);
     /**
      * Mark link to neighbor node as unidirectional for blacklistTimeout
      *
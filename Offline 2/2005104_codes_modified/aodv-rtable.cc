@@ -16,11 +16,13 @@
 
 #include "aodv-rtable.h"
 
+#include "ns3/buffer.h"
 #include "ns3/log.h"
 #include "ns3/simulator.h"
 
 #include <algorithm>
 #include <iomanip>
+#include <tuple>
 
 namespace ns3
 {
@@ -30,6 +32,120 @@ NS_LOG_COMPONENT_DEFINE("AodvRoutingTable");
 namespace aodv
 {
 
+/*
+ The Precursor Set
+ */
+
+PrecursorSet::PrecursorSet()
+    : m_inlineSize(0)
+{
+}
+
+bool
+PrecursorSet::Insert(Ipv4Address id)
+{
+    if (!m_spill.empty())
+    {
+        return m_spill.insert(id).second;
+    }
+    if (Contains(id))
+    {
+        return false;
+    }
+    if (m_inlineSize < INLINE_CAPACITY)
+    {
+        m_inline[m_inlineSize++] = id;
+        return true;
+    }
+    m_spill.insert(m_inline.begin(), m_inline.end());
+    m_spill.insert(id);
+    m_inlineSize = 0;
+    return true;
+}
+
+bool
+PrecursorSet::Contains(Ipv4Address id) const
+{
+    if (!m_spill.empty())
+    {
+        return m_spill.find(id) != m_spill.end();
+    }
+    for (uint32_t i = 0; i < m_inlineSize; ++i)
+    {
+        if (m_inline[i] == id)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool
+PrecursorSet::Erase(Ipv4Address id)
+{
+    if (!m_spill.empty())
+    {
+        return m_spill.erase(id) != 0;
+    }
+    for (uint32_t i = 0; i < m_inlineSize; ++i)
+    {
+        if (m_inline[i] == id)
+        {
+            m_inline[i] = m_inline[--m_inlineSize];
+            return true;
+        }
+    }
+    return false;
+}
+
+void
+PrecursorSet::Clear()
+{
+    m_inlineSize = 0;
+    m_spill.clear();
+}
+
+void
+PrecursorSet::Merge(const PrecursorSet& other)
+{
+    if (!other.m_spill.empty())
+    {
+        if (m_spill.empty())
+        {
+            m_spill.insert(m_inline.begin(), m_inline.begin() + m_inlineSize);
+            m_inlineSize = 0;
+        }
+        m_spill.insert(other.m_spill.begin(), other.m_spill.end());
+        return;
+    }
+    for (uint32_t i = 0; i < other.m_inlineSize; ++i)
+    {
+        Insert(other.m_inline[i]);
+    }
+}
+
+std::vector<Ipv4Address>
+PrecursorSet::GetAddresses() const
+{
+    if (!m_spill.empty())
+    {
+        return std::vector<Ipv4Address>(m_spill.begin(), m_spill.end());
+    }
+    return std::vector<Ipv4Address>(m_inline.begin(), m_inline.begin() + m_inlineSize);
+}
+
+uint64_t
+PrecursorSet::GetHeapSize() const
+{
+    if (m_spill.empty())
+    {
+        return 0;
+    }
+    // A bucket array of pointers, and a node per address with a link and the cached hash
+    return m_spill.bucket_count() * sizeof(void*) +
+           m_spill.size() * (sizeof(Ipv4Address) + 2 * sizeof(void*));
+}
+
 /*
  The Routing Table
  */
@@ -47,50 +163,65 @@ RoutingTableEntry::RoutingTableEntry(Ptr<NetDevice> dev,
       m_validSeqNo(vSeqNo),
       m_seqNo(seqNo),
       m_hops(hops),
-      m_lifeTime(lifetime + Simulator::Now()),
+      m_prefixSize(0),
+      m_expiry(lifetime.GetTimeStep() + Simulator::Now().GetTimeStep()),
+      m_dst(dst),
+      m_nextHop(nextHop),
+      m_source(iface.GetLocal()),
+      m_outputDevice(dev),
       m_iface(iface),
       m_flag(VALID),
       m_reqCount(0),
       m_blackListState(false),
-      m_blackListTimeout(Simulator::Now())
+      m_blackListTimeout(Simulator::Now()),
+      m_congestion_flag(congestion_flag),
+      m_congestionTime(Simulator::Now())
 {
-    m_ipv4Route = Create<Ipv4Route>();
-    m_ipv4Route->SetDestination(dst);
-    m_ipv4Route->SetGateway(nextHop);
-    m_ipv4Route->SetSource(m_iface.GetLocal());
-    m_ipv4Route->SetOutputDevice(dev);
 }
 
 RoutingTableEntry::~RoutingTableEntry()
 {
 }
 
+Ptr<Ipv4Route>
+RoutingTableEntry::GetRoute() const
+{
+    if (!m_ipv4Route)
+    {
+        m_ipv4Route = Create<Ipv4Route>();
+        m_ipv4Route->SetDestination(m_dst);
+        m_ipv4Route->SetGateway(m_nextHop);
+        m_ipv4Route->SetSource(m_source);
+        m_ipv4Route->SetOutputDevice(m_outputDevice);
+    }
+    return m_ipv4Route;
+}
+
+void
+RoutingTableEntry::SetRoute(Ptr<Ipv4Route> r)
+{
+    m_dst = r->GetDestination();
+    m_nextHop = r->GetGateway();
+    m_source = r->GetSource();
+    m_outputDevice = r->GetOutputDevice();
+    m_ipv4Route = r;
+}
+
 bool
 RoutingTableEntry::InsertPrecursor(Ipv4Address id)
 {
     NS_LOG_FUNCTION(this << id);
-    if (!LookupPrecursor(id))
-    {
-        m_precursorList.push_back(id);
-        return true;
-    }
-    else
-    {
-        return false;
-    }
+    return m_precursors.Insert(id);
 }
 
 bool
 RoutingTableEntry::LookupPrecursor(Ipv4Address id)
 {
     NS_LOG_FUNCTION(this << id);
-    for (auto i = m_precursorList.begin(); i != m_precursorList.end(); ++i)
+    if (m_precursors.Contains(id))
     {
-        if (*i == id)
-        {
-            NS_LOG_LOGIC("Precursor " << id << " found");
-            return true;
-        }
+        NS_LOG_LOGIC("Precursor " << id << " found");
+        return true;
     }
     NS_LOG_LOGIC("Precursor " << id << " not found");
     return false;
@@ -100,17 +231,12 @@ bool
 RoutingTableEntry::DeletePrecursor(Ipv4Address id)
 {
     NS_LOG_FUNCTION(this << id);
-    auto i = std::remove(m_precursorList.begin(), m_precursorList.end(), id);
-    if (i == m_precursorList.end())
+    if (!m_precursors.Erase(id))
     {
         NS_LOG_LOGIC("Precursor " << id << " not found");
         return false;
     }
-    else
-    {
-        NS_LOG_LOGIC("Precursor " << id << " found");
-        m_precursorList.erase(i, m_precursorList.end());
-    }
+    NS_LOG_LOGIC("Precursor " << id << " found");
     return true;
 }
 
@@ -118,13 +244,13 @@ void
 RoutingTableEntry::DeleteAllPrecursors()
 {
     NS_LOG_FUNCTION(this);
-    m_precursorList.clear();
+    m_precursors.Clear();
 }
 
 bool
 RoutingTableEntry::IsPrecursorListEmpty() const
 {
-    return m_precursorList.empty();
+    return m_precursors.IsEmpty();
 }
 
 void
@@ -135,22 +261,133 @@ RoutingTableEntry::GetPrecursors(std::vector<Ipv4Address>& prec) const
     {
         return;
     }
-    for (auto i = m_precursorList.begin(); i != m_precursorList.end(); ++i)
+    std::vector<Ipv4Address> precursors = m_precursors.GetAddresses();
+    for (auto i = precursors.begin(); i != precursors.end(); ++i)
     {
-        bool result = true;
-        for (auto j = prec.begin(); j != prec.end(); ++j)
+        if (std::find(prec.begin(), prec.end(), *i) == prec.end())
         {
-            if (*j == *i)
-            {
-                result = false;
-                break;
-            }
+            prec.push_back(*i);
         }
-        if (result)
+    }
+}
+
+void
+RoutingTableEntry::GetPrecursors(PrecursorSet& prec) const
+{
+    NS_LOG_FUNCTION(this);
+    prec.Merge(m_precursors);
+}
+
+bool
+RoutingTableEntry::AddAlternate(Ipv4Address nextHop,
+                                Ptr<NetDevice> dev,
+                                Ipv4InterfaceAddress iface,
+                                uint16_t hops,
+                                uint32_t maxPaths)
+{
+    NS_LOG_FUNCTION(this << nextHop << hops << maxPaths);
+    if (GetPathCount() >= maxPaths || nextHop == m_nextHop)
+    {
+        return false;
+    }
+    for (auto i = m_alternates.begin(); i != m_alternates.end(); ++i)
+    {
+        if (i->nextHop == nextHop)
         {
-            prec.push_back(*i);
+            return false;
         }
     }
+    NS_LOG_LOGIC("Alternate path to " << m_dst << " through " << nextHop);
+    m_alternates.push_back(AlternatePath{nextHop, dev, iface, hops, nullptr});
+    return true;
+}
+
+bool
+RoutingTableEntry::RemoveAlternate(Ipv4Address nextHop)
+{
+    for (auto i = m_alternates.begin(); i != m_alternates.end(); ++i)
+    {
+        if (i->nextHop == nextHop)
+        {
+            m_alternates.erase(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool
+RoutingTableEntry::RemoveNextHop(Ipv4Address nextHop)
+{
+    NS_LOG_FUNCTION(this << nextHop);
+    if (nextHop != m_nextHop)
+    {
+        RemoveAlternate(nextHop);
+        return true;
+    }
+    if (m_alternates.empty())
+    {
+        return false;
+    }
+    AlternatePath& alternate = m_alternates.front();
+    NS_LOG_LOGIC("Fail over route to " << m_dst << " to " << alternate.nextHop);
+    m_nextHop = alternate.nextHop;
+    m_outputDevice = alternate.outputDevice;
+    m_iface = alternate.iface;
+    m_source = alternate.iface.GetLocal();
+    m_hops = alternate.hops;
+    m_ipv4Route = alternate.ipv4Route;
+    m_alternates.erase(m_alternates.begin());
+    return true;
+}
+
+uint64_t
+RoutingTableEntry::GetHeapSize() const
+{
+    uint64_t bytes = m_precursors.GetHeapSize() + m_alternates.size() * sizeof(AlternatePath);
+    if (m_ipv4Route)
+    {
+        bytes += sizeof(Ipv4Route);
+    }
+    for (auto i = m_alternates.begin(); i != m_alternates.end(); ++i)
+    {
+        if (i->ipv4Route)
+        {
+            bytes += sizeof(Ipv4Route);
+        }
+    }
+    return bytes;
+}
+
+std::vector<Ipv4Address>
+RoutingTableEntry::GetAlternateNextHops() const
+{
+    std::vector<Ipv4Address> nextHops;
+    for (auto i = m_alternates.begin(); i != m_alternates.end(); ++i)
+    {
+        nextHops.push_back(i->nextHop);
+    }
+    return nextHops;
+}
+
+Ptr<Ipv4Route>
+RoutingTableEntry::GetRoute(uint32_t path) const
+{
+    if (path == 0)
+    {
+        return GetRoute();
+    }
+    NS_ASSERT(path < GetPathCount());
+    const AlternatePath& alternate = m_alternates[path - 1];
+    if (!alternate.ipv4Route)
+    {
+        alternate.ipv4Route = Create<Ipv4Route>();
+        alternate.ipv4Route->SetDestination(m_dst);
+        alternate.ipv4Route->SetGateway(alternate.nextHop);
+        alternate.ipv4Route->SetSource(alternate.iface.GetLocal());
+        alternate.ipv4Route->SetOutputDevice(alternate.outputDevice);
+    }
+    return alternate.ipv4Route;
 }
 
 void
@@ -163,7 +400,8 @@ RoutingTableEntry::Invalidate(Time badLinkLifetime)
     }
     m_flag = INVALID;
     m_reqCount = 0;
-    m_lifeTime = badLinkLifetime + Simulator::Now();
+    m_alternates.clear();
+    SetLifeTime(badLinkLifetime);
 }
 
 void
@@ -180,10 +418,10 @@ RoutingTableEntry::Print(Ptr<OutputStreamWrapper> stream, Time::Unit unit /* = T
     std::ostringstream gw;
     std::ostringstream iface;
     std::ostringstream expire;
-    dest << m_ipv4Route->GetDestination();
-    gw << m_ipv4Route->GetGateway();
+    dest << m_dst;
+    gw << m_nextHop;
     iface << m_iface.GetLocal();
-    expire << std::setprecision(2) << (m_lifeTime - Simulator::Now()).As(unit);
+    expire << std::setprecision(2) << GetLifeTime().As(unit);
     *os << std::setw(16) << dest.str();
     *os << std::setw(16) << gw.str();
     *os << std::setw(16) << iface.str();
@@ -210,36 +448,355 @@ RoutingTableEntry::Print(Ptr<OutputStreamWrapper> stream, Time::Unit unit /* = T
     (*os).copyfmt(oldState);
 }
 
+/*
+ The routing table hash map
+ */
+
+RouteHashMap::RouteHashMap()
+    : m_shift(32)
+{
+}
+
+uint32_t
+RouteHashMap::FindSlot(uint32_t key) const
+{
+    if (m_slots.empty())
+    {
+        return EMPTY;
+    }
+    uint32_t mask = m_slots.size() - 1;
+    for (uint32_t i = Home(key);; i = (i + 1) & mask)
+    {
+        if (m_slots[i].index == EMPTY)
+        {
+            return EMPTY;
+        }
+        if (m_slots[i].key == key)
+        {
+            return i;
+        }
+    }
+}
+
+RoutingTableEntry*
+RouteHashMap::Find(Ipv4Address dst)
+{
+    uint32_t slot = FindSlot(dst.Get());
+    if (slot == EMPTY)
+    {
+        return nullptr;
+    }
+    return &m_entries[m_slots[slot].index];
+}
+
+std::pair<RoutingTableEntry*, bool>
+RouteHashMap::Insert(const RoutingTableEntry& rt)
+{
+    uint32_t key = rt.GetDestination().Get();
+    // Keep the load factor at most 1/2
+    if (2 * (m_entries.size() + 1) > m_slots.size())
+    {
+        Rehash(std::max<uint32_t>(16, 2 * m_slots.size()));
+    }
+    uint32_t mask = m_slots.size() - 1;
+    uint32_t i = Home(key);
+    for (; m_slots[i].index != EMPTY; i = (i + 1) & mask)
+    {
+        if (m_slots[i].key == key)
+        {
+            return std::make_pair(&m_entries[m_slots[i].index], false);
+        }
+    }
+    m_slots[i].key = key;
+    m_slots[i].index = m_entries.size();
+    m_keys.push_back(key);
+    m_entries.push_back(rt);
+    return std::make_pair(&m_entries.back(), true);
+}
+
+bool
+RouteHashMap::Erase(Ipv4Address dst)
+{
+    uint32_t hole = FindSlot(dst.Get());
+    if (hole == EMPTY)
+    {
+        return false;
+    }
+    uint32_t index = m_slots[hole].index;
+
+    // Shift back the following members of the probe cluster which may not stay behind the hole
+    uint32_t mask = m_slots.size() - 1;
+    for (uint32_t i = (hole + 1) & mask; m_slots[i].index != EMPTY; i = (i + 1) & mask)
+    {
+        uint32_t home = Home(m_slots[i].key);
+        if (((i - home) & mask) >= ((i - hole) & mask))
+        {
+            m_slots[hole] = m_slots[i];
+            hole = i;
+        }
+    }
+    m_slots[hole].index = EMPTY;
+
+    // Move the last entry into the freed place
+    uint32_t last = m_entries.size() - 1;
+    if (index != last)
+    {
+        m_entries[index] = m_entries[last];
+        m_keys[index] = m_keys[last];
+        m_slots[FindSlot(m_keys[index])].index = index;
+    }
+    m_entries.pop_back();
+    m_keys.pop_back();
+    return true;
+}
+
+void
+RouteHashMap::Clear()
+{
+    m_slots.clear();
+    m_keys.clear();
+    m_entries.clear();
+    m_shift = 32;
+}
+
+uint64_t
+RouteHashMap::GetProbeMemoryUsage() const
+{
+    return m_slots.size() * sizeof(Slot);
+}
+
+void
+RouteHashMap::Rehash(uint32_t slots)
+{
+    m_slots.assign(slots, Slot{0, EMPTY});
+    m_shift = 32;
+    for (uint32_t n = slots; n > 1; n >>= 1)
+    {
+        m_shift--;
+    }
+    uint32_t mask = slots - 1;
+    for (uint32_t index = 0; index < m_keys.size(); ++index)
+    {
+        uint32_t i = Home(m_keys[index]);
+        while (m_slots[i].index != EMPTY)
+        {
+            i = (i + 1) & mask;
+        }
+        m_slots[i].key = m_keys[index];
+        m_slots[i].index = index;
+    }
+}
+
 /*
  The Routing Table
  */
 
 RoutingTable::RoutingTable(Time t)
-    : m_badLinkLifetime(t)
+    : m_flatStorage(false),
+      m_badLinkLifetime(t)
 {
 }
 
+RoutingTableEntry*
+RoutingTable::FindEntry(Ipv4Address dst)
+{
+    if (m_flatStorage)
+    {
+        return m_flatEntry.Find(dst);
+    }
+    auto i = m_ipv4AddressEntry.find(dst);
+    if (i == m_ipv4AddressEntry.end())
+    {
+        return nullptr;
+    }
+    return &i->second;
+}
+
+std::pair<RoutingTableEntry*, bool>
+RoutingTable::InsertEntry(const RoutingTableEntry& rt)
+{
+    std::pair<RoutingTableEntry*, bool> result;
+    if (m_flatStorage)
+    {
+        result = m_flatEntry.Insert(rt);
+    }
+    else
+    {
+        auto i = m_ipv4AddressEntry.insert(std::make_pair(rt.GetDestination(), rt));
+        result = std::make_pair(&i.first->second, i.second);
+    }
+    if (result.second)
+    {
+        m_nextHopIndex[rt.GetNextHop()].insert(rt.GetDestination());
+        ReindexAlternates(rt.GetDestination(), {}, rt.GetAlternateNextHops());
+        ReindexPrefixSize(0, rt.GetPrefixSize());
+    }
+    return result;
+}
+
+bool
+RoutingTable::EraseEntry(Ipv4Address dst)
+{
+    RoutingTableEntry* entry = FindEntry(dst);
+    if (entry == nullptr)
+    {
+        return false;
+    }
+    auto i = m_nextHopIndex.find(entry->GetNextHop());
+    NS_ASSERT(i != m_nextHopIndex.end());
+    i->second.erase(dst);
+    if (i->second.empty())
+    {
+        m_nextHopIndex.erase(i);
+    }
+    ReindexAlternates(dst, entry->GetAlternateNextHops(), {});
+    ReindexPrefixSize(entry->GetPrefixSize(), 0);
+    if (m_flatStorage)
+    {
+        return m_flatEntry.Erase(dst);
+    }
+    return m_ipv4AddressEntry.erase(dst) != 0;
+}
+
+void
+RoutingTable::ReindexNextHop(Ipv4Address dst, Ipv4Address oldNextHop, Ipv4Address newNextHop)
+{
+    if (oldNextHop == newNextHop)
+    {
+        return;
+    }
+    auto i = m_nextHopIndex.find(oldNextHop);
+    NS_ASSERT(i != m_nextHopIndex.end());
+    i->second.erase(dst);
+    if (i->second.empty())
+    {
+        m_nextHopIndex.erase(i);
+    }
+    m_nextHopIndex[newNextHop].insert(dst);
+}
+
+void
+RoutingTable::ReindexAlternates(Ipv4Address dst,
+                                const std::vector<Ipv4Address>& oldAlternates,
+                                const std::vector<Ipv4Address>& newAlternates)
+{
+    for (auto i = oldAlternates.begin(); i != oldAlternates.end(); ++i)
+    {
+        auto j = m_alternateIndex.find(*i);
+        NS_ASSERT(j != m_alternateIndex.end());
+        j->second.erase(dst);
+        if (j->second.empty())
+        {
+            m_alternateIndex.erase(j);
+        }
+    }
+    for (auto i = newAlternates.begin(); i != newAlternates.end(); ++i)
+    {
+        m_alternateIndex[*i].insert(dst);
+    }
+}
+
+void
+RoutingTable::ReindexPrefixSize(uint8_t oldPrefixSize, uint8_t newPrefixSize)
+{
+    if (oldPrefixSize == newPrefixSize)
+    {
+        return;
+    }
+    if (oldPrefixSize != 0)
+    {
+        auto i = m_prefixSizes.find(oldPrefixSize);
+        NS_ASSERT(i != m_prefixSizes.end());
+        if (--i->second == 0)
+        {
+            m_prefixSizes.erase(i);
+        }
+    }
+    if (newPrefixSize != 0)
+    {
+        ++m_prefixSizes[newPrefixSize];
+    }
+}
+
+void
+RoutingTable::SetFlatStorage(bool flat)
+{
+    NS_LOG_FUNCTION(this << flat);
+    if (flat == m_flatStorage)
+    {
+        return;
+    }
+    if (flat)
+    {
+        for (auto i = m_ipv4AddressEntry.begin(); i != m_ipv4AddressEntry.end(); ++i)
+        {
+            m_flatEntry.Insert(i->second);
+        }
+        m_ipv4AddressEntry.clear();
+    }
+    else
+    {
+        for (auto i = m_flatEntry.begin(); i != m_flatEntry.end(); ++i)
+        {
+            m_ipv4AddressEntry.insert(std::make_pair(i->GetDestination(), *i));
+        }
+        m_flatEntry.Clear();
+    }
+    m_flatStorage = flat;
+    m_expiryQueue.clear();
+    ForEachEntry([this](RoutingTableEntry& rt) { ScheduleExpiry(rt); });
+}
+
 bool
 RoutingTable::LookupRoute(Ipv4Address id, RoutingTableEntry& rt)
 {
     NS_LOG_FUNCTION(this << id);
     Purge();
-    if (m_ipv4AddressEntry.empty())
+    if (GetEntryCount() == 0)
     {
         NS_LOG_LOGIC("Route to " << id << " not found; m_ipv4AddressEntry is empty");
         return false;
     }
-    auto i = m_ipv4AddressEntry.find(id);
-    if (i == m_ipv4AddressEntry.end())
+    RoutingTableEntry* entry = FindEntry(id);
+    if (entry == nullptr)
     {
         NS_LOG_LOGIC("Route to " << id << " not found");
         return false;
     }
-    rt = i->second;
+    rt = *entry;
     NS_LOG_LOGIC("Route to " << id << " found");
     return true;
 }
 
+const RoutingTableEntry*
+RoutingTable::LookupRoute(Ipv4Address id)
+{
+    NS_LOG_FUNCTION(this << id);
+    Purge();
+    RoutingTableEntry* entry = FindEntry(id);
+    if (entry != nullptr && entry->GetFlag() == VALID)
+    {
+        NS_LOG_LOGIC("Route to " << id << " found");
+        return entry;
+    }
+    // Longest prefix match over the prefix sizes in use, longest first
+    for (auto i = m_prefixSizes.begin(); i != m_prefixSizes.end(); ++i)
+    {
+        Ipv4Mask mask(~uint32_t(0) << (32 - i->first));
+        RoutingTableEntry* prefixRoute = FindEntry(id.CombineMask(mask));
+        if (prefixRoute != nullptr && prefixRoute->GetPrefixSize() == i->first &&
+            prefixRoute->GetFlag() == VALID)
+        {
+            NS_LOG_LOGIC("Route to " << id << " found through prefix route "
+                                     << prefixRoute->GetDestination() << "/"
+                                     << uint32_t(i->first));
+            return prefixRoute;
+        }
+    }
+    NS_LOG_LOGIC("Route to " << id << (entry == nullptr ? " not found" : " found"));
+    return entry;
+}
+
 bool
 RoutingTable::LookupValidRoute(Ipv4Address id, RoutingTableEntry& rt)
 {
@@ -259,7 +816,7 @@ RoutingTable::DeleteRoute(Ipv4Address dst)
 {
     NS_LOG_FUNCTION(this << dst);
     Purge();
-    if (m_ipv4AddressEntry.erase(dst) != 0)
+    if (EraseEntry(dst))
     {
         NS_LOG_LOGIC("Route deletion to " << dst << " successful");
         return true;
@@ -277,7 +834,11 @@ RoutingTable::AddRoute(RoutingTableEntry& rt)
     {
         rt.SetRreqCnt(0);
     }
-    auto result = m_ipv4AddressEntry.insert(std::make_pair(rt.GetDestination(), rt));
+    auto result = InsertEntry(rt);
+    if (result.second)
+    {
+        ScheduleExpiry(*result.first);
+    }
     return result.second;
 }
 
@@ -285,33 +846,76 @@ bool
 RoutingTable::Update(RoutingTableEntry& rt)
 {
     NS_LOG_FUNCTION(this);
-    auto i = m_ipv4AddressEntry.find(rt.GetDestination());
-    if (i == m_ipv4AddressEntry.end())
+    RoutingTableEntry* entry = FindEntry(rt.GetDestination());
+    if (entry == nullptr)
     {
         NS_LOG_LOGIC("Route update to " << rt.GetDestination() << " fails; not found");
         return false;
     }
-    i->second = rt;
-    if (i->second.GetFlag() != IN_SEARCH)
+    Ipv4Address oldNextHop = entry->GetNextHop();
+    std::vector<Ipv4Address> oldAlternates = entry->GetAlternateNextHops();
+    uint8_t oldPrefixSize = entry->GetPrefixSize();
+    *entry = rt;
+    EntryUpdated(*entry, oldNextHop, oldAlternates, oldPrefixSize);
+    return true;
+}
+
+void
+RoutingTable::EntryUpdated(RoutingTableEntry& rt,
+                           Ipv4Address oldNextHop,
+                           const std::vector<Ipv4Address>& oldAlternates,
+                           uint8_t oldPrefixSize)
+{
+    ReindexNextHop(rt.GetDestination(), oldNextHop, rt.GetNextHop());
+    ReindexPrefixSize(oldPrefixSize, rt.GetPrefixSize());
+    if (!oldAlternates.empty() || rt.GetPathCount() > 1)
+    {
+        ReindexAlternates(rt.GetDestination(), oldAlternates, rt.GetAlternateNextHops());
+    }
+    if (rt.GetFlag() != IN_SEARCH)
     {
         NS_LOG_LOGIC("Route update to " << rt.GetDestination() << " set RreqCnt to 0");
-        i->second.SetRreqCnt(0);
+        rt.SetRreqCnt(0);
+    }
+    ScheduleExpiry(rt);
+}
+
+void
+RoutingTable::TouchRoutes(std::initializer_list<Ipv4Address> dsts, Time lifetime)
+{
+    NS_LOG_FUNCTION(this << lifetime);
+    Purge();
+    int64_t expiry = Simulator::Now().GetTimeStep() + lifetime.GetTimeStep();
+    for (auto i = dsts.begin(); i != dsts.end(); ++i)
+    {
+        RoutingTableEntry* entry = FindEntry(*i);
+        if (entry == nullptr || entry->GetFlag() != VALID)
+        {
+            continue;
+        }
+        entry->SetRreqCnt(0);
+        if (expiry > entry->GetExpiryTicks())
+        {
+            NS_LOG_LOGIC("Refresh route to " << *i);
+            entry->SetExpiryTicks(expiry);
+            ScheduleExpiry(*entry);
+        }
     }
-    return true;
 }
 
 bool
 RoutingTable::SetEntryState(Ipv4Address id, RouteFlags state)
 {
     NS_LOG_FUNCTION(this);
-    auto i = m_ipv4AddressEntry.find(id);
-    if (i == m_ipv4AddressEntry.end())
+    RoutingTableEntry* entry = FindEntry(id);
+    if (entry == nullptr)
     {
         NS_LOG_LOGIC("Route set entry state to " << id << " fails; not found");
         return false;
     }
-    i->second.SetFlag(state);
-    i->second.SetRreqCnt(0);
+    entry->SetFlag(state);
+    entry->SetRreqCnt(0);
+    ScheduleExpiry(*entry);
     NS_LOG_LOGIC("Route set entry state to " << id << ": new state is " << state);
     return true;
 }
@@ -323,13 +927,17 @@ RoutingTable::GetListOfDestinationWithNextHop(Ipv4Address nextHop,
     NS_LOG_FUNCTION(this);
     Purge();
     unreachable.clear();
-    for (auto i = m_ipv4AddressEntry.begin(); i != m_ipv4AddressEntry.end(); ++i)
+    auto i = m_nextHopIndex.find(nextHop);
+    if (i == m_nextHopIndex.end())
     {
-        if (i->second.GetNextHop() == nextHop)
-        {
-            NS_LOG_LOGIC("Unreachable insert " << i->first << " " << i->second.GetSeqNo());
-            unreachable.insert(std::make_pair(i->first, i->second.GetSeqNo()));
-        }
+        return;
+    }
+    for (auto j = i->second.begin(); j != i->second.end(); ++j)
+    {
+        RoutingTableEntry* rt = FindEntry(*j);
+        NS_ASSERT(rt != nullptr && rt->GetNextHop() == nextHop);
+        NS_LOG_LOGIC("Unreachable insert " << *j << " " << rt->GetSeqNo());
+        unreachable.insert(std::make_pair(*j, rt->GetSeqNo()));
     }
 }
 
@@ -338,111 +946,193 @@ RoutingTable::InvalidateRoutesWithDst(const std::map<Ipv4Address, uint32_t>& unr
 {
     NS_LOG_FUNCTION(this);
     Purge();
-    for (auto i = m_ipv4AddressEntry.begin(); i != m_ipv4AddressEntry.end(); ++i)
+    for (auto j = unreachable.begin(); j != unreachable.end(); ++j)
     {
-        for (auto j = unreachable.begin(); j != unreachable.end(); ++j)
+        RoutingTableEntry* rt = FindEntry(j->first);
+        if (rt != nullptr && rt->GetFlag() == VALID)
         {
-            if ((i->first == j->first) && (i->second.GetFlag() == VALID))
-            {
-                NS_LOG_LOGIC("Invalidate route with destination address " << i->first);
-                i->second.Invalidate(m_badLinkLifetime);
-            }
+            NS_LOG_LOGIC("Invalidate route with destination address " << j->first);
+            InvalidateEntry(*rt);
         }
     }
 }
 
 void
-RoutingTable::DeleteAllRoutesFromInterface(Ipv4InterfaceAddress iface)
+RoutingTable::InvalidateEntry(RoutingTableEntry& rt)
 {
-    NS_LOG_FUNCTION(this);
-    if (m_ipv4AddressEntry.empty())
+    ReindexAlternates(rt.GetDestination(), rt.GetAlternateNextHops(), {});
+    rt.Invalidate(m_badLinkLifetime);
+    ScheduleExpiry(rt);
+}
+
+void
+RoutingTable::FailOverNextHop(Ipv4Address nextHop)
+{
+    NS_LOG_FUNCTION(this << nextHop);
+    Purge();
+    std::vector<Ipv4Address> affected;
+    auto i = m_alternateIndex.find(nextHop);
+    if (i != m_alternateIndex.end())
     {
-        return;
+        affected.assign(i->second.begin(), i->second.end());
     }
-    for (auto i = m_ipv4AddressEntry.begin(); i != m_ipv4AddressEntry.end();)
+    auto j = m_nextHopIndex.find(nextHop);
+    if (j != m_nextHopIndex.end())
     {
-        if (i->second.GetInterface() == iface)
+        for (auto k = j->second.begin(); k != j->second.end(); ++k)
         {
-            auto tmp = i;
-            ++i;
-            m_ipv4AddressEntry.erase(tmp);
+            RoutingTableEntry* rt = FindEntry(*k);
+            NS_ASSERT(rt != nullptr);
+            if (rt->GetPathCount() > 1 && rt->GetFlag() == VALID)
+            {
+                affected.push_back(*k);
+            }
+        }
+    }
+    for (auto k = affected.begin(); k != affected.end(); ++k)
+    {
+        NS_LOG_LOGIC("Drop path to " << *k << " through " << nextHop);
+        ModifyRoute(*k, [nextHop](RoutingTableEntry& rt) { rt.RemoveNextHop(nextHop); });
+    }
+}
+
+void
+RoutingTable::FailOverNextHop(Ipv4Address nextHop, const std::map<Ipv4Address, uint32_t>& dsts)
+{
+    NS_LOG_FUNCTION(this << nextHop);
+    Purge();
+    for (auto k = dsts.begin(); k != dsts.end(); ++k)
+    {
+        RoutingTableEntry* rt = FindEntry(k->first);
+        if (rt == nullptr)
+        {
+            continue;
         }
-        else
+        // ModifyRoute() may erase the index set of nextHop, so it is looked up every time
+        auto i = m_alternateIndex.find(nextHop);
+        bool alternate = i != m_alternateIndex.end() && i->second.count(k->first) != 0;
+        bool primary =
+            rt->GetNextHop() == nextHop && rt->GetPathCount() > 1 && rt->GetFlag() == VALID;
+        if (alternate || primary)
         {
-            ++i;
+            NS_LOG_LOGIC("Drop path to " << k->first << " through " << nextHop);
+            ModifyRoute(k->first,
+                        [nextHop](RoutingTableEntry& entry) { entry.RemoveNextHop(nextHop); });
         }
     }
 }
 
 void
-RoutingTable::Purge()
+RoutingTable::DeleteAllRoutesFromInterface(Ipv4InterfaceAddress iface)
 {
     NS_LOG_FUNCTION(this);
-    if (m_ipv4AddressEntry.empty())
+    if (GetEntryCount() == 0)
     {
         return;
     }
-    for (auto i = m_ipv4AddressEntry.begin(); i != m_ipv4AddressEntry.end();)
-    {
-        if (i->second.GetLifeTime() < Seconds(0))
-        {
-            if (i->second.GetFlag() == INVALID)
-            {
-                auto tmp = i;
-                ++i;
-                m_ipv4AddressEntry.erase(tmp);
-            }
-            else if (i->second.GetFlag() == VALID)
-            {
-                NS_LOG_LOGIC("Invalidate route with destination address " << i->first);
-                i->second.Invalidate(m_badLinkLifetime);
-                ++i;
-            }
-            else
-            {
-                ++i;
-            }
-        }
-        else
+    std::vector<Ipv4Address> toDelete;
+    ForEachEntry([&toDelete, &iface](RoutingTableEntry& rt) {
+        if (rt.GetInterface() == iface)
         {
-            ++i;
+            toDelete.push_back(rt.GetDestination());
         }
+    });
+    for (auto i = toDelete.begin(); i != toDelete.end(); ++i)
+    {
+        EraseEntry(*i);
     }
 }
 
 void
-RoutingTable::Purge(std::map<Ipv4Address, RoutingTableEntry>& table) const
+RoutingTable::Purge()
 {
     NS_LOG_FUNCTION(this);
-    if (table.empty())
+    int64_t now = Simulator::Now().GetTimeStep();
+    while (!m_expiryQueue.empty() && m_expiryQueue.front().expiry < now)
     {
+        Ipv4Address dst = m_expiryQueue.front().dst;
+        std::pop_heap(m_expiryQueue.begin(), m_expiryQueue.end(), ExpiryRecordLater());
+        m_expiryQueue.pop_back();
+        ExpireEntry(dst, now);
+    }
+}
+
+void
+RoutingTable::ExpireEntry(Ipv4Address dst, int64_t now)
+{
+    RoutingTableEntry* entry = FindEntry(dst);
+    if (entry == nullptr || !entry->IsExpired(now))
+    {
+        // Stale record: the entry was deleted or its lifetime was extended since
         return;
     }
-    for (auto i = table.begin(); i != table.end();)
+    if (entry->GetFlag() == INVALID)
     {
-        if (i->second.GetLifeTime() < Seconds(0))
+        EraseEntry(dst);
+    }
+    else if (entry->GetFlag() == VALID)
+    {
+        NS_LOG_LOGIC("Invalidate route with destination address " << dst);
+        InvalidateEntry(*entry);
+    }
+}
+
+void
+RoutingTable::ScheduleExpiry(const RoutingTableEntry& rt)
+{
+    // Records of refreshed entries pile up; rebuild the heap once they outnumber the entries
+    if (m_expiryQueue.size() > 2 * GetEntryCount() + 16)
+    {
+        m_expiryQueue.clear();
+        ForEachEntry([this](RoutingTableEntry& entry) {
+            m_expiryQueue.push_back({entry.GetExpiryTicks(), entry.GetDestination()});
+        });
+        std::make_heap(m_expiryQueue.begin(), m_expiryQueue.end(), ExpiryRecordLater());
+    }
+    m_expiryQueue.push_back({rt.GetExpiryTicks(), rt.GetDestination()});
+    std::push_heap(m_expiryQueue.begin(), m_expiryQueue.end(), ExpiryRecordLater());
+}
+
+template <typename F>
+void
+RoutingTable::ForEachPurgedEntry(F f) const
+{
+    int64_t now = Simulator::Now().GetTimeStep();
+    auto visit = [this, now, &f](const RoutingTableEntry& rt) {
+        if (!rt.IsExpired(now) || rt.GetFlag() == IN_SEARCH)
         {
-            if (i->second.GetFlag() == INVALID)
-            {
-                auto tmp = i;
-                ++i;
-                table.erase(tmp);
-            }
-            else if (i->second.GetFlag() == VALID)
-            {
-                NS_LOG_LOGIC("Invalidate route with destination address " << i->first);
-                i->second.Invalidate(m_badLinkLifetime);
-                ++i;
-            }
-            else
-            {
-                ++i;
-            }
+            f(rt);
         }
-        else
+        else if (rt.GetFlag() == VALID)
         {
-            ++i;
+            RoutingTableEntry invalidated = rt;
+            invalidated.Invalidate(m_badLinkLifetime);
+            f(invalidated);
         }
+    };
+    if (!m_flatStorage)
+    {
+        for (auto i = m_ipv4AddressEntry.begin(); i != m_ipv4AddressEntry.end(); ++i)
+        {
+            visit(i->second);
+        }
+        return;
+    }
+    // Ordered output is only needed here, so the entries are sorted by reference on demand
+    std::vector<const RoutingTableEntry*> sorted;
+    sorted.reserve(m_flatEntry.GetSize());
+    for (auto i = m_flatEntry.begin(); i != m_flatEntry.end(); ++i)
+    {
+        sorted.push_back(&*i);
+    }
+    std::sort(sorted.begin(),
+              sorted.end(),
+              [](const RoutingTableEntry* a, const RoutingTableEntry* b) {
+                  return a->GetDestination() < b->GetDestination();
+              });
+    for (auto i = sorted.begin(); i != sorted.end(); ++i)
+    {
+        visit(**i);
     }
 }
 
@@ -450,15 +1140,15 @@ bool
 RoutingTable::MarkLinkAsUnidirectional(Ipv4Address neighbor, Time blacklistTimeout)
 {
     NS_LOG_FUNCTION(this << neighbor << blacklistTimeout.As(Time::S));
-    auto i = m_ipv4AddressEntry.find(neighbor);
-    if (i == m_ipv4AddressEntry.end())
+    RoutingTableEntry* entry = FindEntry(neighbor);
+    if (entry == nullptr)
     {
         NS_LOG_LOGIC("Mark link unidirectional to  " << neighbor << " fails; not found");
         return false;
     }
-    i->second.SetUnidirectional(true);
-    i->second.SetBlacklistTimeout(blacklistTimeout);
-    i->second.SetRreqCnt(0);
+    entry->SetUnidirectional(true);
+    entry->SetBlacklistTimeout(blacklistTimeout);
+    entry->SetRreqCnt(0);
     NS_LOG_LOGIC("Set link to " << neighbor << " to unidirectional");
     return true;
 }
@@ -466,8 +1156,6 @@ RoutingTable::MarkLinkAsUnidirectional(Ipv4Address neighbor, Time blacklistTimeo
 void
 RoutingTable::Print(Ptr<OutputStreamWrapper> stream, Time::Unit unit /* = Time::S */) const
 {
-    std::map<Ipv4Address, RoutingTableEntry> table = m_ipv4AddressEntry;
-    Purge(table);
     std::ostream* os = stream->GetStream();
     // Copy the current ostream state
     std::ios oldState(nullptr);
@@ -481,11 +1169,115 @@ RoutingTable::Print(Ptr<OutputStreamWrapper> stream, Time::Unit unit /* = Time::
     *os << std::setw(16) << "Flag";
     *os << std::setw(16) << "Expire";
     *os << "Hops" << std::endl;
-    for (auto i = table.begin(); i != table.end(); ++i)
+    ForEachPurgedEntry([&stream, unit](const RoutingTableEntry& rt) { rt.Print(stream, unit); });
+    *stream->GetStream() << "\n";
+}
+
+void
+RoutingTable::Dump(Ptr<OutputStreamWrapper> stream, uint32_t nodeId) const
+{
+    const uint32_t headerSize = 22;
+    const uint32_t entrySize = 28;
+    int64_t now = Simulator::Now().GetTimeStep();
+    uint32_t count = 0;
+    ForEachPurgedEntry([&count](const RoutingTableEntry&) { count++; });
+
+    Buffer buffer;
+    buffer.AddAtStart(headerSize + count * entrySize);
+    Buffer::Iterator i = buffer.Begin();
+    i.WriteHtonU32(0x414f4456); // "AODV"
+    i.WriteHtonU16(1);
+    i.WriteHtonU32(nodeId);
+    i.WriteHtonU64(now);
+    i.WriteHtonU32(count);
+    ForEachPurgedEntry([&i, now](const RoutingTableEntry& rt) {
+        i.WriteHtonU32(rt.GetDestination().Get());
+        i.WriteHtonU32(rt.GetNextHop().Get());
+        i.WriteHtonU32(rt.GetInterface().GetLocal().Get());
+        i.WriteHtonU32(rt.GetSeqNo());
+        i.WriteHtonU64(rt.GetExpiryTicks() - now);
+        i.WriteHtonU16(rt.GetHop());
+        i.WriteU8(rt.GetFlag());
+        i.WriteU8((rt.GetValidSeqNo() ? 1 : 0) | (rt.IsUnidirectional() ? 2 : 0));
+    });
+    buffer.CopyData(stream->GetStream(), buffer.GetSize());
+}
+
+/// Estimated size of a node of a std::map or std::set besides the value: color and three links
+static const uint64_t TREE_NODE_SIZE = 4 * sizeof(void*);
+
+uint64_t
+RoutingTable::GetEntryMemoryUsage(const RoutingTableEntry& rt) const
+{
+    uint64_t bytes = rt.GetHeapSize();
+    if (m_flatStorage)
     {
-        i->second.Print(stream, unit);
+        bytes += sizeof(RoutingTableEntry) + sizeof(uint32_t) + sizeof(int64_t);
     }
-    *stream->GetStream() << "\n";
+    else
+    {
+        bytes += TREE_NODE_SIZE + sizeof(std::pair<const Ipv4Address, RoutingTableEntry>);
+    }
+    // One record in the next hop index and one per alternate path in the alternate index
+    return bytes + rt.GetPathCount() * (TREE_NODE_SIZE + sizeof(Ipv4Address));
+}
+
+uint64_t
+RoutingTable::GetMemoryUsage() const
+{
+    uint64_t bytes = 0;
+    if (m_flatStorage)
+    {
+        bytes += m_flatEntry.GetProbeMemoryUsage();
+        for (auto i = m_flatEntry.begin(); i != m_flatEntry.end(); ++i)
+        {
+            bytes += GetEntryMemoryUsage(*i);
+        }
+    }
+    else
+    {
+        for (auto i = m_ipv4AddressEntry.begin(); i != m_ipv4AddressEntry.end(); ++i)
+        {
+            bytes += GetEntryMemoryUsage(i->second);
+        }
+    }
+    bytes += m_expiryQueue.size() * sizeof(ExpiryRecord);
+    bytes += (m_nextHopIndex.size() + m_alternateIndex.size()) *
+             (TREE_NODE_SIZE + sizeof(std::pair<const Ipv4Address, std::set<Ipv4Address>>));
+    bytes += m_prefixSizes.size() * (TREE_NODE_SIZE + sizeof(std::pair<const uint8_t, uint32_t>));
+    return bytes;
+}
+
+uint32_t
+RoutingTable::EnforceMemoryBudget(uint64_t budget)
+{
+    NS_LOG_FUNCTION(this << budget);
+    Purge();
+    uint64_t usage = GetMemoryUsage();
+    if (usage <= budget)
+    {
+        return 0;
+    }
+    // (valid, expiration time, destination): invalid and least recently refreshed entries first
+    std::vector<std::tuple<bool, int64_t, Ipv4Address>> victims;
+    ForEachEntry([this, &victims](RoutingTableEntry& rt) {
+        if (rt.GetFlag() != IN_SEARCH && m_nextHopIndex.count(rt.GetDestination()) == 0)
+        {
+            victims.emplace_back(rt.GetFlag() == VALID, rt.GetExpiryTicks(), rt.GetDestination());
+        }
+    });
+    std::sort(victims.begin(), victims.end());
+    uint32_t evicted = 0;
+    for (auto i = victims.begin(); i != victims.end() && usage > budget; ++i)
+    {
+        Ipv4Address dst = std::get<2>(*i);
+        uint64_t bytes = GetEntryMemoryUsage(*FindEntry(dst));
+        NS_LOG_LOGIC("Evict route to " << dst << " to free " << bytes << " bytes");
+        EraseEntry(dst);
+        usage -= std::min(usage, bytes);
+        ++evicted;
+    }
+    return evicted;
 }
 
 } // namespace aodv
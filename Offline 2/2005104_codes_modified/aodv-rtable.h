@@ -22,10 +22,16 @@
 #include "ns3/output-stream-wrapper.h"
 #include "ns3/timer.h"
 
+#include <array>
 #include <cassert>
+#include <functional>
+#include <initializer_list>
 #include <map>
+#include <set>
 #include <stdint.h>
 #include <sys/types.h>
+#include <unordered_set>
+#include <vector>
 
 namespace ns3
 {
@@ -43,6 +49,79 @@ enum RouteFlags
     IN_SEARCH = 2, //!< IN_SEARCH
 };
 
+/**
+ * \ingroup aodv
+ * \brief Set of precursor addresses of a route
+ *
+ * Most routes have only a few precursors, which are kept in a small inline array. Once it is
+ * full the set spills over to a hash set, so that insertion, lookup and merging stay constant
+ * time per address in dense topologies.
+ */
+class PrecursorSet
+{
+  public:
+    PrecursorSet();
+
+    /**
+     * Insert an address if it is not yet in the set
+     * \param id precursor address
+     * \return true if the address was inserted
+     */
+    bool Insert(Ipv4Address id);
+    /**
+     * \param id precursor address
+     * \return true if the address is in the set
+     */
+    bool Contains(Ipv4Address id) const;
+    /**
+     * \param id precursor address
+     * \return true if the address was in the set
+     */
+    bool Erase(Ipv4Address id);
+    /// Remove all addresses
+    void Clear();
+    /**
+     * Insert all addresses of another set
+     * \param other the set to merge into this one
+     */
+    void Merge(const PrecursorSet& other);
+
+    /**
+     * \returns true if the set is empty
+     */
+    bool IsEmpty() const
+    {
+        return GetSize() == 0;
+    }
+
+    /**
+     * \returns the number of addresses
+     */
+    uint32_t GetSize() const
+    {
+        return m_spill.empty() ? m_inlineSize : m_spill.size();
+    }
+
+    /**
+     * \returns the addresses of the set
+     */
+    std::vector<Ipv4Address> GetAddresses() const;
+    /**
+     * \returns an estimate of the bytes the set allocated on the heap
+     */
+    uint64_t GetHeapSize() const;
+
+  private:
+    /// Number of addresses stored without a heap allocation
+    static const uint32_t INLINE_CAPACITY = 4;
+    /// Addresses, while the set has no more than INLINE_CAPACITY of them
+    std::array<Ipv4Address, INLINE_CAPACITY> m_inline;
+    /// Number of valid addresses in m_inline
+    uint32_t m_inlineSize;
+    /// All addresses, once the set outgrew m_inline
+    std::unordered_set<Ipv4Address, Ipv4AddressHash> m_spill;
+};
+
 /**
  * \ingroup aodv
  * \brief Routing table entry
@@ -61,6 +140,7 @@ class RoutingTableEntry
      * \param hops the number of hops
      * \param nextHop the IP address of the next hop
      * \param lifetime the lifetime of the entry
+     * \param congestion_flag the load level reported for the route
      */
     RoutingTableEntry(Ptr<NetDevice> dev = nullptr,
                       Ipv4Address dst = Ipv4Address(),
@@ -106,8 +186,65 @@ class RoutingTableEntry
      * \param prec vector of precursor addresses
      */
     void GetPrecursors(std::vector<Ipv4Address>& prec) const;
+    /**
+     * Inserts precursors in output parameter prec
+     * \param prec set of precursor addresses
+     */
+    void GetPrecursors(PrecursorSet& prec) const;
     //\}
 
+    /// \name Alternate paths (multipath mode)
+    //\{
+    /**
+     * Add an alternate path to the destination through another neighbor. The alternate shares
+     * the destination sequence number and lifetime of the entry; it is dropped when the
+     * sequence number changes or the entry is invalidated.
+     * \param nextHop the next hop of the path, which must differ from those already known
+     * \param dev the output device
+     * \param iface the output interface
+     * \param hops the hop count of the path
+     * \param maxPaths the maximum number of paths including the primary one
+     * \return true if the path was added
+     */
+    bool AddAlternate(Ipv4Address nextHop,
+                      Ptr<NetDevice> dev,
+                      Ipv4InterfaceAddress iface,
+                      uint16_t hops,
+                      uint32_t maxPaths);
+    /**
+     * Remove the path through nextHop. If it is the primary path, the first alternate takes
+     * its place.
+     * \param nextHop the next hop of the path
+     * \return true if the entry still has a path that was not through nextHop
+     */
+    bool RemoveNextHop(Ipv4Address nextHop);
+
+    /**
+     * \returns the number of paths, the primary one included
+     */
+    uint32_t GetPathCount() const
+    {
+        return 1 + m_alternates.size();
+    }
+
+    /**
+     * \returns the next hops of the alternate paths
+     */
+    std::vector<Ipv4Address> GetAlternateNextHops() const;
+    /**
+     * Get the route of a path
+     * \param path the path index, 0 for the primary path and less than GetPathCount()
+     * \returns The IPv4 route
+     */
+    Ptr<Ipv4Route> GetRoute(uint32_t path) const;
+    //\}
+
+    /**
+     * \returns an estimate of the bytes the entry allocated on the heap, for the precursors,
+     * the alternate paths and the routes built by GetRoute()
+     */
+    uint64_t GetHeapSize() const;
+
     /**
      * Mark entry as "down" (i.e. disable it)
      * \param badLinkLifetime duration to keep entry marked as invalid
@@ -121,26 +258,21 @@ class RoutingTableEntry
      */
     Ipv4Address GetDestination() const
     {
-        return m_ipv4Route->GetDestination();
+        return m_dst;
     }
 
     /**
-     * Get route function
+     * Get route function. The route is created on first use and shared by all copies of
+     * the entry until one of its fields is changed.
      * \returns The IPv4 route
      */
-    Ptr<Ipv4Route> GetRoute() const
-    {
-        return m_ipv4Route;
-    }
+    Ptr<Ipv4Route> GetRoute() const;
 
     /**
      * Set route function
      * \param r the IPv4 route
      */
-    void SetRoute(Ptr<Ipv4Route> r)
-    {
-        m_ipv4Route = r;
-    }
+    void SetRoute(Ptr<Ipv4Route> r);
 
     /**
      * Set next hop address
@@ -148,7 +280,12 @@ class RoutingTableEntry
      */
     void SetNextHop(Ipv4Address nextHop)
     {
-        m_ipv4Route->SetGateway(nextHop);
+        m_nextHop = nextHop;
+        m_ipv4Route = nullptr;
+        if (!m_alternates.empty())
+        {
+            RemoveAlternate(nextHop);
+        }
     }
 
     /**
@@ -157,7 +294,7 @@ class RoutingTableEntry
      */
     Ipv4Address GetNextHop() const
     {
-        return m_ipv4Route->GetGateway();
+        return m_nextHop;
     }
 
     /**
@@ -166,7 +303,8 @@ class RoutingTableEntry
      */
     void SetOutputDevice(Ptr<NetDevice> dev)
     {
-        m_ipv4Route->SetOutputDevice(dev);
+        m_outputDevice = dev;
+        m_ipv4Route = nullptr;
     }
 
     /**
@@ -175,7 +313,7 @@ class RoutingTableEntry
      */
     Ptr<NetDevice> GetOutputDevice() const
     {
-        return m_ipv4Route->GetOutputDevice();
+        return m_outputDevice;
     }
 
     /**
@@ -220,6 +358,10 @@ class RoutingTableEntry
      */
     void SetSeqNo(uint32_t sn)
     {
+        if (sn != m_seqNo)
+        {
+            m_alternates.clear();
+        }
         m_seqNo = sn;
     }
 
@@ -250,13 +392,63 @@ class RoutingTableEntry
         return m_hops;
     }
 
+    /**
+     * Set the prefix size. An entry with a nonzero prefix size is a route to all the addresses
+     * that share the first prefix size bits with the destination address, which must have the
+     * remaining bits cleared. The routing table keeps one entry per destination address,
+     * whatever its prefix size.
+     * \param prefixSize the prefix size, 0 for a host route
+     */
+    void SetPrefixSize(uint8_t prefixSize)
+    {
+        m_prefixSize = prefixSize;
+    }
+
+    /**
+     * Get the prefix size
+     * \returns the prefix size, 0 for a host route
+     */
+    uint8_t GetPrefixSize() const
+    {
+        return m_prefixSize;
+    }
+
+    /**
+     * Set the load level reported for the route, by the last RREP for it, and stamp it with the
+     * current time
+     * \param congestionFlag the load level
+     */
+    void SetCongestionFlag(int32_t congestionFlag)
+    {
+        m_congestion_flag = congestionFlag;
+        m_congestionTime = Simulator::Now();
+    }
+
+    /**
+     * Get the load level reported for the route
+     * \returns the load level
+     */
+    int32_t GetCongestionFlag() const
+    {
+        return m_congestion_flag;
+    }
+
+    /**
+     * Get the time at which the load level was reported
+     * \returns the time of the report
+     */
+    Time GetCongestionTime() const
+    {
+        return m_congestionTime;
+    }
+
     /**
      * Set the lifetime
      * \param lt The lifetime
      */
     void SetLifeTime(Time lt)
     {
-        m_lifeTime = lt + Simulator::Now();
+        m_expiry = lt.GetTimeStep() + Simulator::Now().GetTimeStep();
     }
 
     /**
@@ -265,7 +457,34 @@ class RoutingTableEntry
      */
     Time GetLifeTime() const
     {
-        return m_lifeTime - Simulator::Now();
+        return Time(m_expiry - Simulator::Now().GetTimeStep());
+    }
+
+    /**
+     * Set the absolute expiration (or deletion) time
+     * \param expiry the expiration time in time steps
+     */
+    void SetExpiryTicks(int64_t expiry)
+    {
+        m_expiry = expiry;
+    }
+
+    /**
+     * Get the absolute expiration (or deletion) time
+     * \returns the expiration time in time steps
+     */
+    int64_t GetExpiryTicks() const
+    {
+        return m_expiry;
+    }
+
+    /**
+     * \param now the current time in time steps
+     * \returns true if the lifetime has passed
+     */
+    bool IsExpired(int64_t now) const
+    {
+        return m_expiry < now;
     }
 
     /**
@@ -358,7 +577,7 @@ class RoutingTableEntry
      */
     bool operator==(const Ipv4Address dst) const
     {
-        return (m_ipv4Route->GetDestination() == dst);
+        return (m_dst == dst);
     }
 
     /**
@@ -375,27 +594,33 @@ class RoutingTableEntry
     uint32_t m_seqNo;
     /// Hop Count (number of hops needed to reach destination)
     uint16_t m_hops;
+    /// Prefix size of a subnet route, 0 for a host route
+    uint8_t m_prefixSize;
     /**
      * \brief Expiration or deletion time of the route
      * Lifetime field in the routing table plays dual role:
      * for an active route it is the expiration time, and for an invalid route
-     * it is the deletion time.
-     */
-    Time m_lifeTime;
-    /** Ip route, include
-     *   - destination address
-     *   - source address
-     *   - next hop address (gateway)
-     *   - output device
+     * it is the deletion time. Kept as absolute time in time steps, so that
+     * comparing it against the current time needs no Time arithmetic.
      */
-    Ptr<Ipv4Route> m_ipv4Route;
+    int64_t m_expiry;
+    /// Destination address
+    Ipv4Address m_dst;
+    /// Next hop address (gateway)
+    Ipv4Address m_nextHop;
+    /// Source address of the route, the local address of the interface at creation
+    Ipv4Address m_source;
+    /// Output device
+    Ptr<NetDevice> m_outputDevice;
+    /// Ip route built from the fields above by GetRoute(), or null until it is needed
+    mutable Ptr<Ipv4Route> m_ipv4Route;
     /// Output interface address
     Ipv4InterfaceAddress m_iface;
     /// Routing flags: valid, invalid or in search
     RouteFlags m_flag;
 
-    /// List of precursors
-    std::vector<Ipv4Address> m_precursorList;
+    /// Set of precursors
+    PrecursorSet m_precursors;
     /// When I can send another request
     Time m_routeRequestTimeout;
     /// Number of route requests
@@ -405,7 +630,150 @@ class RoutingTableEntry
     /// Time for which the node is put into the blacklist
     Time m_blackListTimeout;
 
+    /// Load level reported for the route
     int32_t m_congestion_flag;
+    /// Time at which the load level was reported
+    Time m_congestionTime;
+
+    /// Alternate path to the destination
+    struct AlternatePath
+    {
+        Ipv4Address nextHop;              ///< Next hop address
+        Ptr<NetDevice> outputDevice;      ///< Output device
+        Ipv4InterfaceAddress iface;       ///< Output interface address
+        uint16_t hops;                    ///< Hop count
+        mutable Ptr<Ipv4Route> ipv4Route; ///< Route built on first use, or null
+    };
+
+    /// Alternate paths, in the order in which they were learned
+    std::vector<AlternatePath> m_alternates;
+
+    /**
+     * Remove the alternate path through nextHop, if there is one
+     * \param nextHop the next hop of the path
+     * \return true if a path was removed
+     */
+    bool RemoveAlternate(Ipv4Address nextHop);
+};
+
+/**
+ * \ingroup aodv
+ * \brief Open-addressing hash map from destination address to routing table entry
+ *
+ * Entries are kept densely in a vector; a power-of-two probe array of (raw IPv4 address,
+ * entry index) pairs is searched with linear probing. Erasing shifts the rest of the probe
+ * cluster back instead of leaving tombstones and moves the last entry into the freed place,
+ * so pointers to entries are only valid until the next Insert() or Erase().
+ */
+class RouteHashMap
+{
+  public:
+    /// constructor
+    RouteHashMap();
+
+    /**
+     * Find entry by destination address
+     * \param dst destination address
+     * \return the entry or nullptr if not found
+     */
+    RoutingTableEntry* Find(Ipv4Address dst);
+    /**
+     * Insert entry if an entry with the same destination doesn't exist yet
+     * \param rt routing table entry
+     * \return the entry with rt's destination and true if rt was inserted
+     */
+    std::pair<RoutingTableEntry*, bool> Insert(const RoutingTableEntry& rt);
+    /**
+     * Erase entry by destination address
+     * \param dst destination address
+     * \return true on success
+     */
+    bool Erase(Ipv4Address dst);
+    /// Delete all entries
+    void Clear();
+
+    /**
+     * \returns the number of entries
+     */
+    uint32_t GetSize() const
+    {
+        return m_entries.size();
+    }
+
+    /**
+     * \returns the bytes used by the probe array
+     */
+    uint64_t GetProbeMemoryUsage() const;
+
+    /**
+     * \returns iterator to the first entry (in no particular order)
+     */
+    std::vector<RoutingTableEntry>::iterator begin()
+    {
+        return m_entries.begin();
+    }
+
+    /**
+     * \returns past-the-end entry iterator
+     */
+    std::vector<RoutingTableEntry>::iterator end()
+    {
+        return m_entries.end();
+    }
+
+    /**
+     * \returns const iterator to the first entry (in no particular order)
+     */
+    std::vector<RoutingTableEntry>::const_iterator begin() const
+    {
+        return m_entries.begin();
+    }
+
+    /**
+     * \returns past-the-end const entry iterator
+     */
+    std::vector<RoutingTableEntry>::const_iterator end() const
+    {
+        return m_entries.end();
+    }
+
+  private:
+    /// Probe array slot
+    struct Slot
+    {
+        uint32_t key;   ///< Raw destination address
+        uint32_t index; ///< Index in m_entries or EMPTY
+    };
+
+    /// Index value of a free slot
+    static const uint32_t EMPTY = 0xffffffff;
+
+    /**
+     * Find the slot holding key
+     * \param key raw destination address
+     * \return slot position or EMPTY if not found
+     */
+    uint32_t FindSlot(uint32_t key) const;
+    /**
+     * Home slot of key
+     * \param key raw destination address
+     * \return slot position
+     */
+    uint32_t Home(uint32_t key) const
+    {
+        return (key * 2654435769U) >> m_shift;
+    }
+
+    /**
+     * Rebuild the probe array with a new number of slots
+     * \param slots the new number of slots, a power of two
+     */
+    void Rehash(uint32_t slots);
+
+    std::vector<Slot> m_slots;                ///< Probe array
+    std::vector<uint32_t> m_keys;             ///< Raw destination address of each entry
+    std::vector<RoutingTableEntry> m_entries; ///< Entries, densely packed
+    uint32_t m_shift;                         ///< 32 - log2 (number of slots)
 };
 
 /**
@@ -463,6 +831,15 @@ class RoutingTable
      * \return true on success
      */
     bool LookupRoute(Ipv4Address dst, RoutingTableEntry& rt);
+    /**
+     * Lookup the routing table entry used to send to dst, without copying it: the entry with
+     * destination address dst if it is VALID, else the VALID prefix route with the longest
+     * prefix that matches dst, else the entry with destination address dst in any state.
+     * \param dst destination address
+     * \return the entry or nullptr if not found; the pointer is only valid until the next
+     *         change of the routing table
+     */
+    const RoutingTableEntry* LookupRoute(Ipv4Address dst);
     /**
      * Lookup route in VALID state
      * \param dst destination address
@@ -476,6 +853,71 @@ class RoutingTable
      * \return true on success
      */
     bool Update(RoutingTableEntry& rt);
+    /**
+     * Modify routing table entry with destination address dst in place, instead of copying it
+     * out with LookupRoute() and back with Update(). The same bookkeeping as in Update() is done
+     * afterwards. modify must not access the routing table.
+     * \param dst destination address
+     * \param modify callable taking RoutingTableEntry&
+     * \return true if the entry exists
+     */
+    template <typename F>
+    bool ModifyRoute(Ipv4Address dst, F modify)
+    {
+        Purge();
+        RoutingTableEntry* entry = FindEntry(dst);
+        if (entry == nullptr)
+        {
+            return false;
+        }
+        Ipv4Address oldNextHop = entry->GetNextHop();
+        std::vector<Ipv4Address> oldAlternates = entry->GetAlternateNextHops();
+        uint8_t oldPrefixSize = entry->GetPrefixSize();
+        modify(*entry);
+        EntryUpdated(*entry, oldNextHop, oldAlternates, oldPrefixSize);
+        return true;
+    }
+    /**
+     * Extend the lifetime of the VALID routes to several destinations to at least lifetime,
+     * with a single Purge(). Touching a destination more than once has no further effect.
+     * \param dsts destination addresses
+     * \param lifetime the minimal lifetime
+     */
+    void TouchRoutes(std::initializer_list<Ipv4Address> dsts, Time lifetime);
+    /**
+     * Do the routing table side of forwarding a data packet from origin to dst: look up the
+     * VALID route to dst, take the path chosen by selectPath and extend the lifetime of the
+     * routes to origin, dst, the next hop and the previous hop to at least lifetime.
+     * selectPath must not access the routing table.
+     * \param origin source address of the packet
+     * \param dst destination address of the packet
+     * \param lifetime the minimal lifetime
+     * \param selectPath callable taking const RoutingTableEntry& and returning a path index
+     * \param originNextHop set to the next hop towards origin, or to the any address if unknown
+     * \returns the route to hand to IP, or 0 if there is no VALID route to dst
+     */
+    template <typename F>
+    Ptr<Ipv4Route> UseRoute(Ipv4Address origin,
+                            Ipv4Address dst,
+                            Time lifetime,
+                            F selectPath,
+                            Ipv4Address& originNextHop)
+    {
+        const RoutingTableEntry* toDst = LookupRoute(dst);
+        if (toDst == nullptr || toDst->GetFlag() != VALID)
+        {
+            return nullptr;
+        }
+        Ptr<Ipv4Route> route = toDst->GetRoute(selectPath(*toDst));
+        // The matched route, which may be a prefix route covering dst
+        Ipv4Address routeDst = toDst->GetDestination();
+        // Looking up origin may purge the table, so toDst is not used past this point
+        const RoutingTableEntry* toOrigin = LookupRoute(origin);
+        Ipv4Address originRoute = toOrigin ? toOrigin->GetDestination() : origin;
+        originNextHop = toOrigin ? toOrigin->GetNextHop() : Ipv4Address();
+        TouchRoutes({originRoute, routeDst, route->GetGateway(), originNextHop}, lifetime);
+        return route;
+    }
     /**
      * Set routing table entry flags
      * \param dst destination address
@@ -485,6 +927,7 @@ class RoutingTable
     bool SetEntryState(Ipv4Address dst, RouteFlags state);
     /**
      * Lookup routing entries with next hop Address dst and not empty list of precursors.
+     * Only the entries with this next hop are visited, see m_nextHopIndex.
      *
      * \param nextHop the next hop IP address
      * \param unreachable
@@ -497,6 +940,7 @@ class RoutingTable
      *    exists and is valid, is incremented.
      * 2. The entry is invalidated by marking the route entry as invalid
      * 3. The Lifetime field is updated to current time plus DELETE_PERIOD.
+     * Each destination is looked up by key, so the cost does not depend on the table size.
      * \param unreachable routes to invalidate
      */
     void InvalidateRoutesWithDst(const std::map<Ipv4Address, uint32_t>& unreachable);
@@ -505,14 +949,52 @@ class RoutingTable
      * \param iface the interface IP address
      */
     void DeleteAllRoutesFromInterface(Ipv4InterfaceAddress iface);
+    /**
+     * Remove the paths through a neighbor whose link broke from all entries that have another
+     * path. Entries whose primary path was through the neighbor switch to an alternate, so that
+     * GetListOfDestinationWithNextHop() no longer reports them.
+     * \param nextHop the neighbor address
+     */
+    void FailOverNextHop(Ipv4Address nextHop);
+    /**
+     * Remove the paths through a neighbor from the given destinations only, as
+     * FailOverNextHop(Ipv4Address) does for all of them. Used when the neighbor reports the
+     * destinations unreachable in a RERR while the link to it still works.
+     * \param nextHop the neighbor address
+     * \param dsts the destinations, with their sequence numbers
+     */
+    void FailOverNextHop(Ipv4Address nextHop, const std::map<Ipv4Address, uint32_t>& dsts);
 
     /// Delete all entries from routing table
     void Clear()
     {
         m_ipv4AddressEntry.clear();
+        m_flatEntry.Clear();
+        m_expiryQueue.clear();
+        m_nextHopIndex.clear();
+        m_alternateIndex.clear();
+        m_prefixSizes.clear();
+    }
+
+    /**
+     * Select the storage of the routing table; existing entries are moved over
+     * \param flat use RouteHashMap instead of std::map
+     */
+    void SetFlatStorage(bool flat);
+
+    /**
+     * \returns true if entries are stored in RouteHashMap
+     */
+    bool IsFlatStorage() const
+    {
+        return m_flatStorage;
     }
 
-    /// Delete all outdated entries and invalidate valid entry if Lifetime is expired
+    /**
+     * Delete all outdated entries and invalidate valid entry if Lifetime is expired.
+     * Only the entries whose expiration time has passed are visited; they are found with
+     * m_expiryQueue, whichever the storage.
+     */
     void Purge();
     /** Mark entry as unidirectional (e.g. add this neighbor to "blacklist" for blacklistTimeout
      * period)
@@ -522,22 +1004,198 @@ class RoutingTable
      */
     bool MarkLinkAsUnidirectional(Ipv4Address neighbor, Time blacklistTimeout);
     /**
-     * Print routing table
+     * Print routing table. Entries are shown as Purge() would leave them, without copying
+     * the table.
      * \param stream the output stream
      * \param unit The time unit to use (default Time::S)
      */
     void Print(Ptr<OutputStreamWrapper> stream, Time::Unit unit = Time::S) const;
+    /**
+     * Write the routing table in a compact binary format for offline processing. Entries are
+     * written as Print() shows them. All fields are in network byte order:
+     *   - header (22 bytes): magic "AODV" (4), format version 1 (2), node id (4),
+     *     current time in time steps (8), number of entries (4)
+     *   - per entry (28 bytes): destination (4), next hop (4), interface address (4),
+     *     sequence number (4), signed remaining lifetime in time steps (8), hop count (2),
+     *     route flags (1), bit 0: valid sequence number and bit 1: unidirectional link (1)
+     * \param stream the output stream
+     * \param nodeId the id of the node owning the table
+     */
+    void Dump(Ptr<OutputStreamWrapper> stream, uint32_t nodeId) const;
+
+    /**
+     * Estimate the memory used by the routing table: the entries with their precursors and
+     * alternate paths, the storage backend, the expiry queue and the indexes. Spare capacity of
+     * the containers is not counted.
+     * \return the estimate in bytes
+     */
+    uint64_t GetMemoryUsage() const;
+    /**
+     * Delete entries until GetMemoryUsage() is no more than budget. INVALID entries go first,
+     * then VALID ones, each least recently refreshed first. Routes in search and routes to the
+     * next hop of another route are kept, so the budget may still be exceeded afterwards.
+     * \param budget the memory budget in bytes
+     * \return the number of deleted entries
+     */
+    uint32_t EnforceMemoryBudget(uint64_t budget);
 
   private:
-    /// The routing table
+    /// Pending expiration of a routing table entry
+    struct ExpiryRecord
+    {
+        int64_t expiry;  ///< Absolute expiration (or deletion) time of the entry, in time steps
+        Ipv4Address dst; ///< Destination of the entry
+    };
+
+    /// Orders expiry records so that the earliest one is on top of the heap
+    struct ExpiryRecordLater
+    {
+        /**
+         * \param a first record
+         * \param b second record
+         * \return true if a expires after b
+         */
+        bool operator()(const ExpiryRecord& a, const ExpiryRecord& b) const
+        {
+            return a.expiry > b.expiry;
+        }
+    };
+
+    /// The routing table, if m_flatStorage is false
     std::map<Ipv4Address, RoutingTableEntry> m_ipv4AddressEntry;
+    /// The routing table, if m_flatStorage is true
+    RouteHashMap m_flatEntry;
+    /// Which of the two containers holds the entries
+    bool m_flatStorage;
+    /**
+     * Min-heap of entry expiration times. Every change of the lifetime or state of an entry
+     * pushes a new record, so records may be stale; Purge() skips those whose entry is gone or
+     * not yet expired.
+     */
+    std::vector<ExpiryRecord> m_expiryQueue;
+    /// Destinations of all entries, by next hop. Kept in sync by InsertEntry(), EraseEntry()
+    /// and EntryUpdated().
+    std::map<Ipv4Address, std::set<Ipv4Address>> m_nextHopIndex;
+    /// Destinations of the entries with an alternate path, by next hop of the alternate
+    std::map<Ipv4Address, std::set<Ipv4Address>> m_alternateIndex;
+    /// Number of prefix routes by prefix size, longest prefix first
+    std::map<uint8_t, uint32_t, std::greater<uint8_t>> m_prefixSizes;
     /// Deletion time for invalid routes
     Time m_badLinkLifetime;
     /**
-     * const version of Purge, for use by Print() method
-     * \param table the routing table entry to purge
+     * Queue the current expiration time of an entry for Purge()
+     * \param rt the stored routing table entry
+     */
+    void ScheduleExpiry(const RoutingTableEntry& rt);
+    /**
+     * Delete or invalidate an entry found by Purge(), if its lifetime has expired
+     * \param dst destination address
+     * \param now the current time in time steps
+     */
+    void ExpireEntry(Ipv4Address dst, int64_t now);
+    /**
+     * Bookkeeping after an entry has been replaced or modified by Update() or ModifyRoute()
+     * \param rt the stored routing table entry
+     * \param oldNextHop the next hop of the entry before the change
+     * \param oldAlternates the next hops of the alternate paths before the change
+     * \param oldPrefixSize the prefix size of the entry before the change
+     */
+    void EntryUpdated(RoutingTableEntry& rt,
+                      Ipv4Address oldNextHop,
+                      const std::vector<Ipv4Address>& oldAlternates,
+                      uint8_t oldPrefixSize);
+    /**
+     * Update m_alternateIndex after the alternate paths of an entry changed
+     * \param dst destination address of the entry
+     * \param oldAlternates the previous next hops of the alternate paths
+     * \param newAlternates the new next hops of the alternate paths
+     */
+    void ReindexAlternates(Ipv4Address dst,
+                           const std::vector<Ipv4Address>& oldAlternates,
+                           const std::vector<Ipv4Address>& newAlternates);
+    /**
+     * Estimate the memory used by an entry in the storage backend and in the next hop and
+     * alternate indexes, see GetMemoryUsage()
+     * \param rt the stored routing table entry
+     * \return the estimate in bytes
+     */
+    uint64_t GetEntryMemoryUsage(const RoutingTableEntry& rt) const;
+    /**
+     * Update m_prefixSizes after the prefix size of an entry changed
+     * \param oldPrefixSize the previous prefix size, 0 if the entry did not exist
+     * \param newPrefixSize the new prefix size, 0 if the entry no longer exists
+     */
+    void ReindexPrefixSize(uint8_t oldPrefixSize, uint8_t newPrefixSize);
+    /**
+     * Invalidate a stored entry and schedule its deletion
+     * \param rt the stored routing table entry
+     */
+    void InvalidateEntry(RoutingTableEntry& rt);
+    /**
+     * Move an entry from one next hop to another in m_nextHopIndex
+     * \param dst destination address of the entry
+     * \param oldNextHop the previous next hop
+     * \param newNextHop the new next hop
+     */
+    void ReindexNextHop(Ipv4Address dst, Ipv4Address oldNextHop, Ipv4Address newNextHop);
+
+    /// \name Storage access, independent of m_flatStorage
+    //\{
+    /**
+     * \param dst destination address
+     * \return the entry or nullptr if not found
+     */
+    RoutingTableEntry* FindEntry(Ipv4Address dst);
+    /**
+     * \param rt entry to insert if its destination is not in the table yet
+     * \return the stored entry and true if rt was inserted
+     */
+    std::pair<RoutingTableEntry*, bool> InsertEntry(const RoutingTableEntry& rt);
+    /**
+     * \param dst destination address
+     * \return true if an entry was erased
+     */
+    bool EraseEntry(Ipv4Address dst);
+
+    /**
+     * \returns the number of entries
+     */
+    uint32_t GetEntryCount() const
+    {
+        return m_flatStorage ? m_flatEntry.GetSize() : m_ipv4AddressEntry.size();
+    }
+
+    /**
+     * Call f for every entry. f must not add or remove entries.
+     * \param f callable taking RoutingTableEntry&
+     */
+    template <typename F>
+    void ForEachEntry(F f)
+    {
+        if (m_flatStorage)
+        {
+            for (auto& rt : m_flatEntry)
+            {
+                f(rt);
+            }
+        }
+        else
+        {
+            for (auto& i : m_ipv4AddressEntry)
+            {
+                f(i.second);
+            }
+        }
+    }
+    //\}
+    /**
+     * Call f for every entry in the order of destination addresses, as Purge() would leave
+     * them: expired invalid entries are skipped and expired valid entries are passed as
+     * invalidated copies. For use by Print() and Dump().
+     * \param f callable taking const RoutingTableEntry&
      */
-    void Purge(std::map<Ipv4Address, RoutingTableEntry>& table) const;
+    template <typename F>
+    void ForEachPurgedEntry(F f) const;
 };
 
 } // namespace aodv